@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include "../../netcoding/netcoding-layer.h"
 #include "../../netcoding/netcoding.h"
 #include "../../netcoding/utils.h"
 #include "contiki-lib.h"
@@ -16,12 +17,13 @@
 #define UDP_SENDER_PORT 3200
 
 #define SEND_INTERVAL (4 * CLOCK_SECOND)
+#define OCCUPANCY_INTERVAL (5 * CLOCK_SECOND)
 
 #define LOG_MODULE "Coding"
 #define LOG_LEVEL LOG_LEVEL_INFO
 
 static struct simple_udp_connection udp_connection;
-static char buffer[PACKET_SIZE];
+static char buffer[NETCODING_MAX_PACKET_SIZE];
 static uip_ipaddr_t addr;
 
 /*---------------------------------------------------------------------------*/
@@ -36,20 +38,24 @@ static void receiver_callback(struct simple_udp_connection *c,
                               const uint8_t *data,
                               uint16_t datalen) {
     static netcoding_packet packet;
-    memcpy(&packet, data, PACKET_SIZE);
+    if(!unpack_packet_header(data, datalen, &packet)) return;
 
     netcoding_log_format(
         "NORMAL", network_coding_node.id, 1, (uip_ip6addr_t *)sender_addr);
-    print_packet(&packet);
+    printf("Header: [");
+    print_header(&packet.header);
+    printf("]\n");
 }
 /*---------------------------------------------------------------------------*/
 PROCESS_THREAD(udp_process, ev, data) {
+    static struct etimer occupancy_timer;
     uip_ipaddr_t dest_addr;
 
-    create_netcoding_normal_routing_node(node_id);
-
     PROCESS_BEGIN();
 
+    create_netcoding_normal_routing_node(node_id);
+    netcoding_layer_init();
+
     NETSTACK_MAC.on();
 
     simple_udp_register(&udp_connection,
@@ -58,10 +64,21 @@ PROCESS_THREAD(udp_process, ev, data) {
                         UDP_RECEIVER_PORT,
                         receiver_callback);
 
-    printf("PACKET SIZE = %d in router %d with ip ", (int)PACKET_SIZE, node_id);
+    printf("PACKET SIZE = %d in router %d with ip ", (int)NETCODING_MAX_PACKET_SIZE, node_id);
     log_6addr(&uip_ds6_get_link_local(-1)->ipaddr);
     printf("\n");
 
+    // Withheld packets and event counters, read by simulacoes/parse-log.py
+    etimer_set(&occupancy_timer, OCCUPANCY_INTERVAL);
+    while(1) {
+        PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&occupancy_timer));
+        etimer_reset(&occupancy_timer);
+        printf("BUFFER raw=%d combination=%d\n",
+               network_coding_node.raw_buffer.size,
+               network_coding_node.combination_buffer.size);
+        print_stats(&network_coding_node.stats);
+    }
+
     PROCESS_END();
 }
 /*---------------------------------------------------------------------------*/
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include "../../netcoding/netcoding-layer.h"
 #include "../../netcoding/netcoding.h"
 #include "../../netcoding/utils.h"
 #include "contiki-lib.h"
@@ -31,9 +32,9 @@ static void handle_decoded_packet(linked_list_node *node) {
     uip_ip6addr(&sender_addr, 0xfd00, 0, 0, 0, 0X201, 0X0, 0X0, 0X0);
 
     netcoding_log_format("RECV-D", network_coding_node.id, 1, &sender_addr);
-
-    print_packet(packet);
-    printf("\n");
+    printf("Header: [");
+    print_header(&packet->header);
+    printf("]\n");
 }
 
 static void print_headers(linked_list_node *node) {
@@ -51,30 +52,36 @@ static void receiver_callback(struct simple_udp_connection *c,
                               const uint8_t *data,
                               uint16_t datalen) {
     static netcoding_packet packet;
-    memcpy(&packet, data, PACKET_SIZE);
+    /* The payload is decoded right out of the datagram */
+    if(!unpack_packet_header(data, datalen, &packet)) return;
 
     netcoding_log_format(
         "RECV  ", network_coding_node.id, 1, (uip_ip6addr_t *)sender_addr);
-    print_packet(&packet);
-    printf("\n");
+    printf("Header: [");
+    print_header(&packet.header);
+    printf("]\n");
 
     struct linked_list_t *decoded_packets =
-        decode_packets(&network_coding_node, &packet);
+        decode_packets_view(&network_coding_node,
+                            &packet,
+                            (const char *)NETCODING_PACKET_BODY(data, datalen));
 
     if(decoded_packets->size) {
         printf("DECODED PACKETS:\n");
         iterate_over_list(decoded_packets, handle_decoded_packet);
     }
 
-    free_list(decoded_packets);
+    clear_list(decoded_packets);
+    netcoding_layer_acknowledge();
 }
 /*----------------------------------------------------------------------------*/
 PROCESS_THREAD(udp_server_process, ev, data) {
-    create_netcoding_normal_routing_node(node_id);
-
     PROCESS_BEGIN();
 
-    printf("PACKET SIZE = %d in node %d with ip ", (int)PACKET_SIZE, node_id);
+    create_netcoding_normal_routing_node(node_id);
+    netcoding_layer_init();
+
+    printf("PACKET SIZE = %d in node %d with ip ", (int)NETCODING_MAX_PACKET_SIZE, node_id);
     log_6addr(&uip_ds6_get_link_local(-1)->ipaddr);
     printf("\n");
 
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include "../../netcoding/netcoding-layer.h"
 #include "../../netcoding/netcoding.h"
 #include "contiki-lib.h"
 #include "contiki-net.h"
@@ -42,12 +43,13 @@ PROCESS_THREAD(udp_process, ev, data) {
     static struct etimer periodic_timer;
     uip_ipaddr_t dest_ipaddr;
 
-    create_netcoding_normal_routing_node(node_id);
-
     uip_ip6addr(&dest_ipaddr, 0xfd00, 0, 0, 0, 0X201, 0X1, 0X1, 0X1);
 
     PROCESS_BEGIN();
 
+    create_netcoding_normal_routing_node(node_id);
+    netcoding_layer_init();
+
     NETSTACK_MAC.on();
 
     simple_udp_register(&udp_connection,
@@ -58,36 +60,38 @@ PROCESS_THREAD(udp_process, ev, data) {
 
     etimer_set(&periodic_timer, SEND_INTERVAL);
 
-    printf("PACKET SIZE = %d in node %d with ip ", (int)PACKET_SIZE, node_id);
+    printf("PACKET SIZE = %d in node %d with ip ", (int)NETCODING_MAX_PACKET_SIZE, node_id);
     log_6addr(&uip_ds6_get_link_local(-1)->ipaddr);
     printf("\n");
 
-    static int packet_id;
-    packet_id = node_id;
+    static uint32_t num_sent;
+    static uint32_t packet_id;
     static netcoding_packet packet;
-    char packet_message[PAYLOAD_SIZE];
-    static char buffer[PACKET_SIZE];
+    static char packet_message[PAYLOAD_SIZE];
+    static int packet_len;
+    static uint8_t buffer[NETCODING_MAX_PACKET_SIZE];
 
     while(1) {
-        // Make sure no packet is going to have and invalid id
-        // packet_id++;
-        // packet_id %= EMPTY_PACKET_ID;
-
         PROCESS_WAIT_EVENT_UNTIL(etimer_expired(&periodic_timer));
         etimer_reset(&periodic_timer);
         /*====================================================================*/
         if(NETSTACK_ROUTING.node_is_reachable()) {
+            packet_id = get_sender_packet_id(node_id, num_sent++);
             memset(packet_message, 0, PAYLOAD_SIZE);
-            sprintf(packet_message, "Message %d from %d", packet_id, node_id);
+            sprintf(packet_message,
+                    "Message %lu from %d",
+                    (unsigned long)packet_id,
+                    node_id);
             packet = create_packet(packet_id, packet_message);
-            memcpy(buffer, &packet, sizeof(packet));
+            packet_len = pack_packet(&packet, buffer);
 
-            printf("Sending message %d to ", packet_id);
+            printf("Sending message %lu to ", (unsigned long)packet_id);
             log_6addr(&dest_ipaddr);
             printf("\n");
 
             simple_udp_sendto(
-                &udp_connection, buffer, PACKET_SIZE, &dest_ipaddr);
+                &udp_connection, buffer, packet_len, &dest_ipaddr);
+            print_stats(&network_coding_node.stats);
         }
     }
 
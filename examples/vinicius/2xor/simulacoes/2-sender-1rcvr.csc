@@ -198,4 +198,22 @@
     </plugin_config>
     <bounds x="874" y="0" height="160" width="1674" z="2" />
   </plugin>
+  <plugin>
+    org.contikios.cooja.plugins.ScriptRunner
+    <plugin_config>
+      <script>/* The router (node 3) must combine the packets of the two senders */
+TIMEOUT(600000, log.testFailed());
+
+while(true) {
+  YIELD_THEN_WAIT_UNTIL(id == 3 &amp;&amp; msg.startsWith("STATS"));
+  var coded = / coded=(\d+)/.exec(msg);
+  if(coded != null &amp;&amp; parseInt(coded[1]) &gt; 0) {
+    log.log("router coded " + coded[1] + " packets\n");
+    log.testOK();
+  }
+}</script>
+      <active>true</active>
+    </plugin_config>
+    <bounds x="1037" y="40" height="700" width="600" />
+  </plugin>
 </simconf>
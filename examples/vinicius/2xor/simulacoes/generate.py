@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+"""Generates a headless Cooja simulation of the 2xor nodes.
+
+Node 1 is the receiver (the RPL root), the senders come right after it and
+every other node is a router. The script of the simulation writes every mote
+output line to the test log, as "<time in us>\tID:<id>\t<line>", and ends it
+after the given duration; parse-log.py reads the metrics out of it.
+
+    ./generate.py grid --nodes 49 --senders 4 --loss 0.1 -o grid-49.csc
+    ./generate.py line --nodes 20 --baseline --make-args MAKE_MAC=MAKE_MAC_CSMA
+"""
+
+import argparse
+import math
+import random
+import sys
+from xml.sax.saxutils import escape
+
+MOTE_INTERFACES = [
+    "org.contikios.cooja.interfaces.Position",
+    "org.contikios.cooja.interfaces.Battery",
+    "org.contikios.cooja.contikimote.interfaces.ContikiVib",
+    "org.contikios.cooja.contikimote.interfaces.ContikiMoteID",
+    "org.contikios.cooja.contikimote.interfaces.ContikiRS232",
+    "org.contikios.cooja.contikimote.interfaces.ContikiBeeper",
+    "org.contikios.cooja.interfaces.IPAddress",
+    "org.contikios.cooja.contikimote.interfaces.ContikiRadio",
+    "org.contikios.cooja.contikimote.interfaces.ContikiButton",
+    "org.contikios.cooja.contikimote.interfaces.ContikiPIR",
+    "org.contikios.cooja.contikimote.interfaces.ContikiClock",
+    "org.contikios.cooja.contikimote.interfaces.ContikiLED",
+    "org.contikios.cooja.contikimote.interfaces.ContikiCFS",
+    "org.contikios.cooja.contikimote.interfaces.ContikiEEPROM",
+    "org.contikios.cooja.interfaces.Mote2MoteRelations",
+    "org.contikios.cooja.interfaces.MoteAttributes",
+]
+
+SCRIPT = """TIMEOUT(%d, log.testOK());
+while(true) {
+  log.log(time + "\\tID:" + id + "\\t" + msg + "\\n");
+  YIELD();
+}"""
+
+
+# ------------------- TOPOLOGIES ----------------------------------------------
+# Each one returns the positions of the nodes: the receiver, then the
+# senders, then the routers.
+
+def line(args, spacing):
+    """A chain from the receiver to the senders, at its far end."""
+    positions = [(i * spacing, 0.0) for i in range(args.nodes)]
+    return [positions[0]] + positions[-args.senders:] \
+        + positions[1:-args.senders]
+
+
+def butterfly(args, spacing):
+    """The butterfly: two senders whose flows share the bottleneck C-D, each
+    with a side path (A or B) to the receiver, so the receiver gets one of
+    the natives of each combination sent through the bottleneck. It always
+    has 7 nodes."""
+    d = spacing
+    receiver = (d, 3 * d)
+    senders = [(0.0, 0.0), (2 * d, 0.0)]
+    routers = [(d, d), (d, 2 * d), (0.0, 2 * d), (2 * d, 2 * d)]
+    return [receiver] + senders + routers
+
+
+def grid(args, spacing):
+    """A square grid with the receiver at a corner and the senders at the
+    opposite one."""
+    side = math.ceil(math.sqrt(args.nodes))
+    positions = [(i % side * spacing, i // side * spacing)
+                 for i in range(args.nodes)]
+    return [positions[0]] + positions[-args.senders:] \
+        + positions[1:-args.senders]
+
+
+def uniform(args, spacing):
+    """Nodes spread uniformly over a square sized for about 8 neighbors per
+    node, with the receiver at its center and the farthest nodes sending."""
+    rng = random.Random(args.seed)
+    side = math.sqrt(args.nodes * math.pi * args.range ** 2 / 8)
+    receiver = (side / 2, side / 2)
+    others = [(rng.uniform(0, side), rng.uniform(0, side))
+              for _ in range(args.nodes - 1)]
+    others.sort(key=lambda p: math.dist(p, receiver), reverse=True)
+    return [receiver] + others[:args.senders] + others[args.senders:]
+
+
+TOPOLOGIES = {
+    "line": line,
+    "butterfly": butterfly,
+    "grid": grid,
+    "random": uniform,
+}
+
+
+# ------------------- SIMULATION ----------------------------------------------
+def mote_type(name, ids, positions, make_args):
+    commands = "$(MAKE) TARGET=cooja clean\n" \
+        "$(MAKE) -j$(CPUS) %s.cooja TARGET=cooja %s" % (name, make_args)
+    out = ["    <motetype>",
+           "      org.contikios.cooja.contikimote.ContikiMoteType",
+           "      <description>%s</description>" % name,
+           "      <source>[CONTIKI_DIR]/examples/vinicius/2xor/%s/%s.c</source>"
+           % (name, name),
+           "      <commands>%s</commands>" % escape(commands.strip())]
+    out += ["      <moteinterface>%s</moteinterface>" % i
+            for i in MOTE_INTERFACES]
+    for node_id, (x, y) in zip(ids, positions):
+        out += ["      <mote>",
+                "        <interface_config>",
+                "          org.contikios.cooja.interfaces.Position",
+                '          <pos x="%.2f" y="%.2f" />' % (x, y),
+                "        </interface_config>",
+                "        <interface_config>",
+                "          org.contikios.cooja.contikimote.interfaces."
+                "ContikiMoteID",
+                "          <id>%d</id>" % node_id,
+                "        </interface_config>",
+                "      </mote>"]
+    out.append("    </motetype>")
+    return out
+
+
+def simulation(args):
+    positions = TOPOLOGIES[args.topology](args, args.range * 0.7)
+    senders = positions[1:args.senders + 1]
+    routers = positions[args.senders + 1:]
+    router = "normal" if args.baseline else "router"
+    title = "%s-%d-loss%g%s" % (args.topology, len(positions), args.loss,
+                                "-rpl" if args.baseline else "")
+
+    out = ['<?xml version="1.0" encoding="UTF-8"?>',
+           '<simconf version="2023090101">',
+           "  <simulation>",
+           "    <title>%s</title>" % title,
+           "    <randomseed>%d</randomseed>" % args.seed,
+           "    <motedelay_us>1000000</motedelay_us>",
+           "    <radiomedium>",
+           "      org.contikios.cooja.radiomediums.UDGM",
+           "      <transmitting_range>%.1f</transmitting_range>" % args.range,
+           "      <interference_range>%.1f</interference_range>"
+           % (args.range * 2),
+           "      <success_ratio_tx>1.0</success_ratio_tx>",
+           "      <success_ratio_rx>%.3f</success_ratio_rx>"
+           % (1 - args.loss),
+           "    </radiomedium>",
+           "    <events>",
+           "      <logoutput>40000</logoutput>",
+           "    </events>"]
+    out += mote_type("receiver", [1], positions[:1], args.make_args)
+    out += mote_type("sender", range(2, len(senders) + 2), senders,
+                     "NUM_SENDERS=%d %s" % (len(senders), args.make_args))
+    if routers:
+        out += mote_type(router, range(len(senders) + 2, len(positions) + 1),
+                         routers, args.make_args)
+    out += ["  </simulation>",
+            "  <plugin>",
+            "    org.contikios.cooja.plugins.ScriptRunner",
+            "    <plugin_config>",
+            "      <script>%s</script>"
+            % escape(SCRIPT % (args.duration * 1000)),
+            "      <active>true</active>",
+            "    </plugin_config>",
+            "  </plugin>",
+            "</simconf>"]
+    return "\n".join(out) + "\n"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("topology", choices=TOPOLOGIES)
+    parser.add_argument("--nodes", type=int, default=10,
+                        help="number of nodes (the butterfly has always 7)")
+    parser.add_argument("--senders", type=int, default=2)
+    parser.add_argument("--loss", type=float, default=0.0,
+                        help="probability of losing a frame at a receiver")
+    parser.add_argument("--range", type=float, default=50.0,
+                        help="transmission range, in meters")
+    parser.add_argument("--duration", type=int, default=600,
+                        help="simulated time, in seconds")
+    parser.add_argument("--seed", type=int, default=123456)
+    parser.add_argument("--baseline", action="store_true",
+                        help="routers only forward (plain RPL)")
+    parser.add_argument("--make-args", default="",
+                        help="extra make arguments of every node, e.g. "
+                        "'NETCODING_COPE=1 MAKE_MAC=MAKE_MAC_CSMA'")
+    parser.add_argument("-o", "--output", help="default: standard output")
+    args = parser.parse_args()
+
+    if args.senders < 1 or args.nodes < args.senders + 1:
+        parser.error("need at least a receiver and a sender")
+    csc = simulation(args)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(csc)
+    else:
+        sys.stdout.write(csc)
+
+
+if __name__ == "__main__":
+    main()
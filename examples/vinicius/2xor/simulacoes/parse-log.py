@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Computes the metrics of 2xor simulation runs out of their logs.
+
+Reads the test logs written by the simulations of generate.py (or logs saved
+from the Cooja LogListener), one line per mote output, and prints a CSV row
+per log:
+
+- sent, delivered: native packets sent and decoded by the receiver;
+- goodput: payload bytes delivered per second, from the first packet sent;
+- transmissions: network coding packets sent by every node, from the last
+  event counters ("STATS" lines) each node printed;
+- coded: combinations made, each saving a transmission with pairwise
+  combinations (NUM_COMBINATIONS 2);
+- delay: mean and maximum time from the sending of a packet to its decoding,
+  in ms;
+- occupancy: mean and maximum packets withheld by a router ("BUFFER" lines).
+
+    ./parse-log.py --payload 30 runs/*.testlog
+"""
+
+import argparse
+import collections
+import csv
+import re
+import sys
+
+LINE = re.compile(r"^(?P<time>[\d:.]+)\s+ID:(?P<id>\d+)\s+(?P<msg>.*)$")
+SENT = re.compile(r"Sending message (\d+)")
+DECODED = re.compile(r"^\[RECV-D\|.*Header: \[(\d+)")
+BUFFER = re.compile(r"BUFFER raw=(\d+) combination=(\d+)")
+STATS = re.compile(r"^STATS((?: [\w-]+=\d+)+)$")
+RECEIVER_ID = 1
+FIELDS = ["log", "sent", "delivered", "delivery_ratio", "goodput_Bps",
+          "transmissions", "coded", "delay_mean_ms", "delay_max_ms",
+          "occupancy_mean", "occupancy_max"]
+
+
+def parse_time(text):
+    """The time in microseconds, from "<us>" or "[[hh:]mm:]ss.mmm"."""
+    if ":" not in text and "." not in text:
+        return int(text)
+    seconds = 0.0
+    for part in text.split(":"):
+        seconds = seconds * 60 + float(part)
+    return int(seconds * 1000000)
+
+
+def parse(path, payload):
+    sent_at = collections.defaultdict(collections.deque)
+    delivered = set()
+    delays = []
+    counts = collections.Counter()
+    occupancy = []
+    stats = {}
+    first_sent = last = None
+
+    with open(path, errors="replace") as f:
+        for raw in f:
+            match = LINE.match(raw.strip())
+            if not match:
+                continue
+            time = parse_time(match.group("time"))
+            node_id = int(match.group("id"))
+            msg = match.group("msg")
+            last = time
+
+            if (found := SENT.search(msg)):
+                sent_at[int(found.group(1))].append(time)
+                counts["sent"] += 1
+                if first_sent is None:
+                    first_sent = time
+            elif (found := STATS.match(msg)):
+                # The counters are cumulative, the last line of a node wins
+                stats[node_id] = {name: int(value) for name, value in
+                                  (field.split("=") for field in
+                                   found.group(1).split())}
+            elif (found := BUFFER.search(msg)):
+                occupancy.append(int(found.group(1)) + int(found.group(2)))
+            elif node_id == RECEIVER_ID and (found := DECODED.search(msg)):
+                packet_id = int(found.group(1))
+                if packet_id in delivered and not sent_at[packet_id]:
+                    continue
+                delivered.add(packet_id)
+                # Ids are unique within a run, should one repeat the oldest
+                # pending sending of the id is taken
+                if sent_at[packet_id]:
+                    delays.append(time - sent_at[packet_id].popleft())
+
+    elapsed = (last - first_sent) / 1000000 if first_sent is not None else 0
+    return {
+        "log": path,
+        "sent": counts["sent"],
+        "delivered": len(delays),
+        "delivery_ratio": round(len(delays) / counts["sent"], 3)
+        if counts["sent"] else 0,
+        "goodput_Bps": round(len(delays) * payload / elapsed, 2)
+        if elapsed > 0 else 0,
+        "transmissions": sum(node.get("sent", 0) for node in stats.values()),
+        "coded": sum(node.get("coded", 0) for node in stats.values()),
+        "delay_mean_ms": round(sum(delays) / len(delays) / 1000, 1)
+        if delays else "",
+        "delay_max_ms": round(max(delays) / 1000, 1) if delays else "",
+        "occupancy_mean": round(sum(occupancy) / len(occupancy), 2)
+        if occupancy else "",
+        "occupancy_max": max(occupancy) if occupancy else "",
+    }
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("logs", nargs="+")
+    parser.add_argument("--payload", type=int, default=30,
+                        help="network coding payload size, in bytes")
+    parser.add_argument("--no-header", action="store_true")
+    args = parser.parse_args()
+
+    writer = csv.DictWriter(sys.stdout, FIELDS)
+    if not args.no_header:
+        writer.writeheader()
+    for path in args.logs:
+        writer.writerow(parse(path, args.payload))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,63 @@
+#!/bin/bash
+# Runs the 2xor simulation suite headless and summarizes it in a CSV file:
+# every topology and loss rate, with plain RPL forwarding (rpl) and with each
+# combination policy. The lists can be overridden from the environment, e.g.
+#   TOPOLOGIES="grid" NODES=100 LOSSES="0 0.2" SEEDS="1 2 3" ./run.sh
+# Extra make arguments of every node go in MAKE_ARGS, e.g.
+#   MAKE_ARGS="NETCODING_COPE=1 MAKE_MAC=MAKE_MAC_CSMA" ./run.sh
+
+cd "$(dirname "$0")" || exit 1
+CONTIKI=$(realpath ../../../..)
+GRADLE=$CONTIKI/tools/cooja/gradlew
+
+TOPOLOGIES=${TOPOLOGIES:-"line butterfly grid random"}
+NODES=${NODES:-25}
+SENDERS=${SENDERS:-2}
+LOSSES=${LOSSES:-"0 0.1 0.3"}
+SEEDS=${SEEDS:-1}
+DURATION=${DURATION:-600}
+PAYLOAD=${PAYLOAD:-30}
+CONFIGS=${CONFIGS:-"rpl netcoding_policy_probability netcoding_policy_queue netcoding_policy_etx"}
+OUT=${OUT:-runs}
+
+mkdir -p "$OUT"
+rm -f "$OUT/summary.csv"
+
+for topology in $TOPOLOGIES; do
+  for loss in $LOSSES; do
+    for seed in $SEEDS; do
+      for config in $CONFIGS; do
+        name=$topology-$NODES-loss$loss-seed$seed-$config
+        if [ "$config" = rpl ]; then
+          options="--baseline"
+          make_args="$MAKE_ARGS"
+        else
+          options=""
+          make_args="NETCODING_POLICY=$config $MAKE_ARGS"
+        fi
+        mkdir -p "$OUT/$name"
+        ./generate.py "$topology" --nodes "$NODES" --senders "$SENDERS" \
+          --loss "$loss" --seed "$seed" --duration "$DURATION" $options \
+          --make-args "NETCODING_PAYLOAD_SIZE=$PAYLOAD $make_args" \
+          -o "$OUT/$name/$name.csc" || exit 1
+
+        echo "Running $name"
+        $GRADLE --no-watch-fs --parallel --build-cache -p "$CONTIKI/tools/cooja" run \
+          -Dslf4j.provider=ch.qos.logback.classic.spi.LogbackServiceProvider \
+          --args="--no-gui --contiki=$CONTIKI --logdir=$(realpath "$OUT/$name") --random-seed=$seed $(realpath "$OUT/$name/$name.csc")" \
+          >"$OUT/$name/cooja.log" 2>&1 || echo "FAIL $name (see $OUT/$name/cooja.log)"
+
+        for log in "$OUT/$name"/*.testlog; do
+          [ -f "$log" ] || continue
+          if [ -f "$OUT/summary.csv" ]; then
+            ./parse-log.py --payload "$PAYLOAD" --no-header "$log" >>"$OUT/summary.csv"
+          else
+            ./parse-log.py --payload "$PAYLOAD" "$log" >"$OUT/summary.csv"
+          fi
+        done
+      done
+    done
+  done
+done
+
+echo "Summary in $OUT/summary.csv"
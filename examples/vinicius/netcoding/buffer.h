@@ -1,11 +1,51 @@
 #ifndef NET_CODING_BUFFER_H_
 #define NET_CODING_BUFFER_H_
 
+#include <stdbool.h>
 #include <stdlib.h>
+#include "lib/memb.h"
 #include "packet.h"
 
 /* ------------------- CIRCULAR BUFFER -------------------------------------- */
+#ifdef NETCODING_CONF_WINDOW_SIZE
+#define NETCODING_WINDOW_SIZE NETCODING_CONF_WINDOW_SIZE
+#else
 #define NETCODING_WINDOW_SIZE 8
+#endif
+
+/**
+ * @brief Number of 32-bit words of a bitmap with one bit per buffer slot.
+ *
+ */
+#define NETCODING_BITMAP_WORDS ((NETCODING_WINDOW_SIZE + 31) / 32)
+
+/**
+ * @brief Number of chains of the id index of a buffer.
+ *
+ */
+#define NETCODING_INDEX_BUCKETS (NETCODING_WINDOW_SIZE * 2)
+
+/**
+ * @brief Number of flows, i.e., (next hop, destination) pairs, a node tells
+ * apart among its withheld packets. Packets of further flows, or with an
+ * unknown route, are withheld as NETCODING_FLOW_NONE.
+ *
+ */
+#ifdef NETCODING_CONF_FLOWS
+#define NETCODING_FLOWS NETCODING_CONF_FLOWS
+#else
+#define NETCODING_FLOWS 4
+#endif
+
+#define NETCODING_FLOW_NONE 0xFF
+
+/**
+ * @brief Number of generation classes of the index of a buffer. A buffer
+ * holds at most NETCODING_WINDOW_SIZE generations, so each class rarely
+ * holds more than one of them.
+ *
+ */
+#define NETCODING_INDEX_GENERATIONS NETCODING_WINDOW_SIZE
 
 /**
  * @brief A generic linked list node.
@@ -14,115 +54,529 @@
 typedef struct linked_list_node_t {
     void* data;
     struct linked_list_node_t* next;
+    struct linked_list_node_t* prev;
 } linked_list_node;
 
 /**
- * @brief A packet buffer with limited size.
+ * @brief Secondary index of the packets stored in a buffer, by buffer slot
+ * (the position of the packet block in the buffer pool). It allows finding a
+ * fitting packet without scanning the buffer.
+ *
+ */
+typedef struct packet_index_t {
+    /**
+     * @brief Bitmaps of the slots whose packets hold `i + 1` packet ids.
+     *
+     */
+    uint32_t by_size[NUM_COMBINATIONS][NETCODING_BITMAP_WORDS];
+    /**
+     * @brief Hash chains from a packet id to the slots holding it. An entry
+     * `e` stands for the member `e % NUM_COMBINATIONS` of the slot
+     * `e / NUM_COMBINATIONS`, and is stored plus one, so 0 ends a chain.
+     *
+     */
+    uint16_t buckets[NETCODING_INDEX_BUCKETS];
+    uint16_t next[NETCODING_WINDOW_SIZE * NUM_COMBINATIONS];
+    /**
+     * @brief Bitmaps of the slots whose packets belong to a generation `g`,
+     * at `g % NETCODING_INDEX_GENERATIONS`.
+     *
+     */
+    uint32_t by_generation[NETCODING_INDEX_GENERATIONS][NETCODING_BITMAP_WORDS];
+    /**
+     * @brief Bitmaps of the slots of each flow, which make up the queue of
+     * the flow.
+     *
+     */
+    uint32_t by_flow[NETCODING_FLOWS][NETCODING_BITMAP_WORDS];
+} packet_index;
+
+/**
+ * @brief A predicate over two packet headers, e.g. `are_fitting_headers`.
+ *
+ */
+typedef int (*header_predicate)(netcoding_packet_header*,
+                                netcoding_packet_header*);
+
+/**
+ * @brief Where a stored packet was being routed to when it got withheld.
+ *
+ */
+typedef struct netcoding_route_t {
+    netcoding_addr next_hop;
+    netcoding_addr destination;
+    /**
+     * @brief The IPv6 addresses, hop limit and UDP ports (in network byte
+     * order) of the datagram, to forward the packet as it came once it is
+     * flushed.
+     *
+     */
+    uint8_t source_ip[16];
+    uint8_t destination_ip[16];
+    uint8_t hop_limit;
+    uint16_t source_port;
+    uint16_t destination_port;
+    /**
+     * @brief The flow of the packet once withheld, or NETCODING_FLOW_NONE.
+     *
+     */
+    uint8_t flow;
+    /**
+     * @brief The link quality towards the next hop, for the combination
+     * policies: its ETX (LINK_STATS_ETX_DIVISOR fixed point, 0 if unknown) and
+     * the number of frames waiting for the MAC.
+     *
+     */
+    uint16_t etx;
+    uint8_t backlog;
+} netcoding_route;
+
+/**
+ * @brief A pool block holding a list node together with the packet it points
+ * to, so storing a packet costs a single fixed-size allocation.
+ *
+ */
+typedef struct netcoding_slot_t {
+    linked_list_node node;
+    netcoding_route route;
+    /**
+     * @brief When a withheld packet has to be flushed.
+     *
+     */
+    clock_time_t deadline;
+    netcoding_packet packet;
+} netcoding_slot;
+
+/**
+ * @brief A packet buffer with limited size. Its capacity is the number of
+ * blocks in the pool it allocates from, which may be shared by other lists.
  *
  */
 typedef struct linked_list_t {
     linked_list_node* head;
     linked_list_node* tail;
     int size;
+    struct memb* pool;
+    /**
+     * @brief The index of the stored packets, or NULL for plain lists.
+     *
+     */
+    packet_index* index;
 } packet_buffer;
 
-static void start_list(struct linked_list_t* list) {
+/**
+ * @brief Sets up a memb pool over caller provided storage. The storage lives
+ * inside the netcoding node so every translation unit including these headers
+ * shares the same blocks.
+ *
+ * @param pool The pool to be initialized.
+ * @param used The allocation bitmap, MEMB_USED_WORDS(num) words.
+ * @param mem The array with the blocks themselves.
+ * @param block_size The size of each block.
+ * @param num The number of blocks.
+ */
+static void init_pool(struct memb* pool,
+                      uint32_t* used,
+                      void* mem,
+                      unsigned short block_size,
+                      unsigned short num) {
+    pool->size = block_size;
+    pool->num = num;
+    pool->used = used;
+    pool->mem = mem;
+    memb_init(pool);
+}
+
+static void start_list(struct linked_list_t* list, struct memb* pool) {
     list->head = NULL;
     list->tail = NULL;
     list->size = 0;
+    list->pool = pool;
+    list->index = NULL;
+}
+
+/**
+ * @brief Starts a list whose packets are indexed. The pool must not have more
+ * than NETCODING_WINDOW_SIZE blocks.
+ *
+ * @param list
+ * @param pool
+ * @param index The index storage.
+ */
+static void start_indexed_list(struct linked_list_t* list,
+                               struct memb* pool,
+                               packet_index* index) {
+    start_list(list, pool);
+    memset(index, 0, sizeof(packet_index));
+    list->index = index;
+}
+
+/**
+ * @brief Get the number of packets that can still be stored in the buffer.
+ *
+ * @param buffer
+ * @return int
+ */
+static inline int buffer_free_slots(packet_buffer* buffer) {
+    return (int)memb_numfree(buffer->pool);
+}
+
+/* ------------------- INDEX ------------------------------------------------ */
+static inline int get_slot_index(packet_buffer* buffer, netcoding_slot* slot) {
+    return ((char*)slot - (char*)buffer->pool->mem) / buffer->pool->size;
+}
+
+static inline netcoding_slot* get_slot(packet_buffer* buffer, int slot_index) {
+    return (netcoding_slot*)((char*)buffer->pool->mem
+                             + slot_index * buffer->pool->size);
+}
+
+static inline int get_id_bucket(uint32_t packet_id) {
+    return (packet_id * 2654435761u) % NETCODING_INDEX_BUCKETS;
+}
+
+static void index_packet(packet_buffer* buffer, netcoding_slot* slot) {
+    packet_index* index = buffer->index;
+    netcoding_packet_header* header = &slot->packet.header;
+    int slot_index = get_slot_index(buffer, slot);
+    int num_packets = get_header_num_packets(header);
+
+    if(!num_packets) return;
+
+    for(int i = 0; i < num_packets; i++) {
+        int bucket = get_id_bucket(header->holding_packets[i]);
+        int entry = slot_index * NUM_COMBINATIONS + i;
+
+        index->next[entry] = index->buckets[bucket];
+        index->buckets[bucket] = entry + 1;
+    }
+    index->by_size[num_packets - 1][slot_index / 32] |= 1u << (slot_index % 32);
+    index->by_generation[get_header_generation(header)
+                         % NETCODING_INDEX_GENERATIONS][slot_index / 32] |=
+        1u << (slot_index % 32);
+    if(slot->route.flow != NETCODING_FLOW_NONE)
+        index->by_flow[slot->route.flow][slot_index / 32] |=
+            1u << (slot_index % 32);
+}
+
+static void unindex_packet(packet_buffer* buffer, netcoding_slot* slot) {
+    packet_index* index = buffer->index;
+    netcoding_packet_header* header = &slot->packet.header;
+    int slot_index = get_slot_index(buffer, slot);
+    int num_packets = get_header_num_packets(header);
+
+    if(!num_packets) return;
+
+    for(int i = 0; i < num_packets; i++) {
+        int bucket = get_id_bucket(header->holding_packets[i]);
+        uint16_t* link = &index->buckets[bucket];
+        int entry = slot_index * NUM_COMBINATIONS + i;
+
+        while(*link && *link != entry + 1) link = &index->next[*link - 1];
+        if(*link) *link = index->next[entry];
+    }
+    index->by_size[num_packets - 1][slot_index / 32] &=
+        ~(1u << (slot_index % 32));
+    index->by_generation[get_header_generation(header)
+                         % NETCODING_INDEX_GENERATIONS][slot_index / 32] &=
+        ~(1u << (slot_index % 32));
+    if(slot->route.flow != NETCODING_FLOW_NONE)
+        index->by_flow[slot->route.flow][slot_index / 32] &=
+            ~(1u << (slot_index % 32));
+}
+
+/**
+ * @brief Counts the slots of a bitmap.
+ *
+ * @param slots
+ * @return int
+ */
+static inline int count_slots(const uint32_t slots[NETCODING_BITMAP_WORDS]) {
+    int count = 0;
+
+    for(int word = 0; word < NETCODING_BITMAP_WORDS; word++)
+        count += __builtin_popcount(slots[word]);
+    return count;
+}
+
+/**
+ * @brief Marks in a bitmap every slot holding any of the header packets. It
+ * walks one hash chain per packet id of the header.
+ *
+ * @param buffer
+ * @param header
+ * @param slots The bitmap to be filled.
+ */
+static void get_sharing_slots(packet_buffer* buffer,
+                              netcoding_packet_header* header,
+                              uint32_t slots[NETCODING_BITMAP_WORDS]) {
+    packet_index* index = buffer->index;
+
+    for(int i = 0; i < get_header_num_packets(header); i++) {
+        uint32_t packet_id = header->holding_packets[i];
+        uint16_t entry = index->buckets[get_id_bucket(packet_id)];
+
+        for(; entry; entry = index->next[entry - 1]) {
+            int slot_index = (entry - 1) / NUM_COMBINATIONS;
+            int member = (entry - 1) % NUM_COMBINATIONS;
+
+            if(get_slot(buffer, slot_index)
+                   ->packet.header.holding_packets[member]
+               == packet_id)
+                slots[slot_index / 32] |= 1u << (slot_index % 32);
+        }
+    }
 }
 
-static packet_buffer create_buffer() {
-    packet_buffer buffer;
-    start_list(&buffer);
-    return buffer;
+/* ------------------- BUFFER ----------------------------------------------- */
+/**
+ * @brief Unlinks a slot from the buffer and gives it back to the pool.
+ *
+ * @param buffer
+ * @param slot
+ */
+static void remove_slot(packet_buffer* buffer, netcoding_slot* slot) {
+    linked_list_node* node = &slot->node;
+
+    if(buffer->index) unindex_packet(buffer, slot);
+
+    if(node->prev) node->prev->next = node->next;
+    else
+        buffer->head = node->next;
+    if(node->next) node->next->prev = node->prev;
+    else
+        buffer->tail = node->prev;
+
+    buffer->size--;
+    memb_free(buffer->pool, slot);
 }
 
-static int find_packet(packet_buffer* buffer,
-                       netcoding_packet* original_packet,
-                       netcoding_packet* output_packet) {
+/**
+ * @brief Removes every packet going to a destination of the generations in
+ * `[from, to)`. Only the slots indexed under those generations are visited,
+ * so it costs one bitmap per generation and O(1) per evicted packet.
+ *
+ * @param buffer An indexed buffer.
+ * @param from The oldest generation to be removed.
+ * @param to The oldest generation to be kept, past `from`.
+ * @param destination The destination of the packets to be removed.
+ * @return int The number of packets evicted.
+ */
+static int evict_generations(packet_buffer* buffer,
+                             uint32_t from,
+                             uint32_t to,
+                             netcoding_addr destination) {
+    uint32_t first = from;
+    int evicted = 0;
+
+    // Beyond that, every class is visited anyway
+    if(to - from > NETCODING_INDEX_GENERATIONS)
+        first = to - NETCODING_INDEX_GENERATIONS;
+
+    for(uint32_t generation = first; generation < to; generation++) {
+        uint32_t* slots = buffer->index->by_generation
+                              [generation % NETCODING_INDEX_GENERATIONS];
+
+        for(int word = 0; word < NETCODING_BITMAP_WORDS; word++) {
+            uint32_t bits = slots[word];
+
+            while(bits) {
+                netcoding_slot* slot =
+                    get_slot(buffer, word * 32 + __builtin_ctz(bits));
+                bits &= bits - 1;
+
+                uint32_t slot_generation =
+                    get_header_generation(&slot->packet.header);
+
+                if(slot->route.destination == destination
+                   && slot_generation >= from && slot_generation < to) {
+                    remove_slot(buffer, slot);
+                    evicted++;
+                }
+            }
+        }
+    }
+    return evicted;
+}
+
+/**
+ * @brief Searches the buffer for a packet equivalent to the input one.
+ *
+ * @param buffer
+ * @param original_packet
+ * @return netcoding_packet* The stored packet or NULL if there is none.
+ */
+static netcoding_packet* find_packet(packet_buffer* buffer,
+                                     netcoding_packet* original_packet) {
+    netcoding_packet_header* header = &original_packet->header;
+
+    if(buffer->index) {
+        // Headers are sorted, then equivalent ones share the first packet id
+        uint32_t packet_id = header->holding_packets[0];
+        uint16_t entry = buffer->index->buckets[get_id_bucket(packet_id)];
+
+        for(; entry; entry = buffer->index->next[entry - 1]) {
+            if((entry - 1) % NUM_COMBINATIONS) continue;
+
+            netcoding_packet* packet =
+                &get_slot(buffer, (entry - 1) / NUM_COMBINATIONS)->packet;
+            if(are_equivalent_headers(&packet->header, header)) return packet;
+        }
+        return NULL;
+    }
+
     linked_list_node* cur_node = buffer->head;
 
     while(cur_node) {
         netcoding_packet* packet = (netcoding_packet*)cur_node->data;
 
-        if(are_equivalent_headers(&packet->header, &original_packet->header)) {
-            output_packet = packet;
-            return 1;
-        }
+        if(are_equivalent_headers(&packet->header, header)) return packet;
 
         cur_node = cur_node->next;
     }
-    return 0;
+    return NULL;
+}
+
+/**
+ * @brief Get the first fitting packet among the slots of a bitmap.
+ *
+ */
+static netcoding_slot* find_fitting_slot(packet_buffer* buffer,
+                                         uint32_t slots[NETCODING_BITMAP_WORDS],
+                                         netcoding_packet_header* original_header,
+                                         header_predicate is_fitting) {
+    for(int word = 0; word < NETCODING_BITMAP_WORDS; word++) {
+        uint32_t bits = slots[word];
+
+        while(bits) {
+            int slot_index = word * 32 + __builtin_ctz(bits);
+            netcoding_slot* slot = get_slot(buffer, slot_index);
+            bits &= bits - 1;
+
+            if(is_fitting(original_header, &slot->packet.header)) return slot;
+        }
+    }
+    return NULL;
 }
 
 /**
  * @brief Searches in a packet buffer for a fitting packet to the input one.
+ * Using the buffer index, the only candidates are the packets small enough to
+ * fit and, after them, the packets sharing ids with the input one, which may
+ * only fit when recoding. The packet stays in the buffer, so it can be
+ * combined right from its slot before `remove_slot` is called.
  *
  * @param buffer The packet buffer to be scanned.
  * @param original_header The packet we want to find another one fitting it.
- * @param output_packet The pointer to store the result packet.
- * @return int 1 if a packet was found and removed and 0 otherwise.
+ * @param is_fitting The predicate telling whether two headers fit.
+ * @param allowed The bitmap of the slots that may be taken, or NULL for all
+ * of them. It is ignored by plain lists.
+ * @return netcoding_slot* The slot of the packet or NULL if there is none.
  */
-static int pop_fitting_packet(packet_buffer* buffer,
-                              netcoding_packet_header* original_header,
-                              netcoding_packet* output_packet) {
-    if(!buffer->size) return 0;
+static netcoding_slot* find_fitting_packet(packet_buffer* buffer,
+                                           netcoding_packet_header* original_header,
+                                           header_predicate is_fitting,
+                                           const uint32_t* allowed) {
+    if(!buffer->size) return NULL;
+
+    if(buffer->index) {
+        uint32_t candidates[NETCODING_BITMAP_WORDS] = {0};
+        uint32_t sharing[NETCODING_BITMAP_WORDS] = {0};
+        int room = NUM_COMBINATIONS - get_header_num_packets(original_header);
+        netcoding_slot* slot;
+
+        get_sharing_slots(buffer, original_header, sharing);
+        for(int word = 0; word < NETCODING_BITMAP_WORDS; word++) {
+            if(allowed) sharing[word] &= allowed[word];
+            for(int size = 1; size <= room; size++)
+                candidates[word] |= buffer->index->by_size[size - 1][word];
+            candidates[word] &= ~sharing[word];
+            if(allowed) candidates[word] &= allowed[word];
+        }
+
+        slot = find_fitting_slot(buffer, candidates, original_header, is_fitting);
+        if(slot) return slot;
+        return find_fitting_slot(buffer, sharing, original_header, is_fitting);
+    }
 
     linked_list_node* cur_node = buffer->head;
-    linked_list_node* last_node = NULL;
 
     while(cur_node) {
         netcoding_packet* packet = (netcoding_packet*)cur_node->data;
 
-        if(are_fitting_headers(original_header, &packet->header)) {
-            *output_packet = *packet;
+        if(is_fitting(original_header, &packet->header))
+            return (netcoding_slot*)cur_node;
 
-            // It's head node
-            if(last_node == NULL) buffer->head = cur_node->next;
-            // It's tail node
-            else if(cur_node->next == NULL)
-                buffer->tail = last_node;
-            // It's middle node
-            else
-                last_node->next = cur_node->next;
-
-            buffer->size--;
-
-            free(cur_node->data);
-            free(cur_node);
-            return 1;
-        }
-
-        last_node = cur_node;
         cur_node = cur_node->next;
     }
 
-    return 0;
+    return NULL;
 }
 
 /**
- * @brief Adds a packet into a packet buffer.
+ * @brief Pops a fitting packet to the input one out of a packet buffer,
+ * reference `find_fitting_packet`.
+ *
+ * @param buffer The packet buffer to be scanned.
+ * @param original_header The packet we want to find another one fitting it.
+ * @param is_fitting The predicate telling whether two headers fit.
+ * @param allowed The bitmap of the slots that may be taken, or NULL for all
+ * of them. It is ignored by plain lists.
+ * @param output_packet The pointer to store the result packet.
+ * @return int 1 if a packet was found and removed and 0 otherwise.
+ */
+static inline int pop_fitting_packet(packet_buffer* buffer,
+                                     netcoding_packet_header* original_header,
+                                     header_predicate is_fitting,
+                                     const uint32_t* allowed,
+                                     netcoding_packet* output_packet) {
+    netcoding_slot* slot =
+        find_fitting_packet(buffer, original_header, is_fitting, allowed);
+
+    if(!slot) return 0;
+    *output_packet = slot->packet;
+    remove_slot(buffer, slot);
+    return 1;
+}
+
+/**
+ * @brief Adds a packet into a packet buffer, along with its route. Its payload
+ * is copied from `body`, which may lie outside the packet (e.g. inside the uip
+ * buffer), so it is the only copy of the payload made.
  *
  * @param buffer The packet buffer to be incremented.
- * @param packet The packet to be added.
+ * @param packet The packet to be added, whose body is not read.
+ * @param body The PAYLOAD_SIZE bytes of its payload.
+ * @param route The route of the packet, or NULL if it is unknown.
  * @return int 1 if a packet was added and 0 otherwise.
  */
-static int push_packet(packet_buffer* buffer, netcoding_packet* packet) {
-    if(buffer->size == NETCODING_WINDOW_SIZE) return 0;
-    netcoding_packet* _;
-    if(find_packet(buffer, packet, _)) return 0;
-
-    linked_list_node* node =
-        (linked_list_node*)malloc(sizeof(linked_list_node));
-    netcoding_packet* cloned_packet =
-        (netcoding_packet*)malloc(sizeof(netcoding_packet));
-    // !Since I'm not here to make a performant code implementation, I just want
-    // !to return as value in all situations. Since the buffer needs to use
-    // !pointers, just copy the whole data.
-    *cloned_packet = *packet;
-    node->data = cloned_packet;
+static int push_routed_packet(packet_buffer* buffer,
+                              netcoding_packet* packet,
+                              const char* body,
+                              netcoding_route* route) {
+    if(find_packet(buffer, packet)) return 0;
+
+    netcoding_slot* slot = (netcoding_slot*)memb_alloc(buffer->pool);
+    // The pool is exhausted, so the buffer is full
+    if(slot == NULL) return 0;
+
+    linked_list_node* node = &slot->node;
+    slot->packet.header = packet->header;
+#if NETCODING_COPE
+    slot->packet.cope = packet->cope;
+#endif
+    memcpy(slot->packet.body, body, PAYLOAD_SIZE);
+    slot->deadline = 0;
+    if(route) slot->route = *route;
+    else {
+        memset(&slot->route, 0, sizeof(netcoding_route));
+        slot->route.next_hop = NETCODING_ADDR_NONE;
+        slot->route.destination = NETCODING_ADDR_NONE;
+        slot->route.flow = NETCODING_FLOW_NONE;
+    }
+    node->data = &slot->packet;
     node->next = NULL;
+    node->prev = buffer->tail;
 
     // Is empty buffer
     if(buffer->head == NULL) {
@@ -133,46 +587,44 @@ static int push_packet(packet_buffer* buffer, netcoding_packet* packet) {
         buffer->tail->next = node;
         buffer->tail = node;
     }
+    if(buffer->index) index_packet(buffer, slot);
 
     buffer->size++;
     return 1;
 }
 
-static void free_list(struct linked_list_t* list) {
-    linked_list_node* cur_node = list->head;
-
-    while(cur_node) {
-        linked_list_node* tmp = cur_node->next;
-        free(cur_node->data);
-        free(cur_node);
-        cur_node = tmp;
-    }
-    free(list);
+/**
+ * @brief Adds a packet into a packet buffer.
+ *
+ * @param buffer The packet buffer to be incremented.
+ * @param packet The packet to be added.
+ * @return int 1 if a packet was added and 0 otherwise.
+ */
+static int push_packet(packet_buffer* buffer, netcoding_packet* packet) {
+    return push_routed_packet(buffer, packet, packet->body, NULL);
 }
 
+/**
+ * @brief Removes every packet from the list, giving its slots back to the pool.
+ *
+ * @param list
+ */
 static void clear_list(struct linked_list_t* list) {
     linked_list_node* cur_node = list->head;
 
     while(cur_node) {
         linked_list_node* tmp = cur_node->next;
-        free(cur_node->data);
-        free(cur_node);
+        memb_free(list->pool, cur_node);
         cur_node = tmp;
     }
     list->head = NULL;
     list->tail = NULL;
     list->size = 0;
+    if(list->index) memset(list->index, 0, sizeof(packet_index));
 }
 
-static void transfer_list(struct linked_list_t* from,
-                          struct linked_list_t* to) {
-    to->head = from->head;
-    to->tail = from->tail;
-    to->size = from->size;
-}
-
-static void iterate_over_list(struct linked_list_t* list,
-                              void (*iterator_callback)(linked_list_node*)) {
+static inline void iterate_over_list(
+    struct linked_list_t* list, void (*iterator_callback)(linked_list_node*)) {
     linked_list_node* cur_node = list->head;
 
     while(cur_node) {
@@ -182,4 +634,4 @@ static void iterate_over_list(struct linked_list_t* list,
     }
 }
 
-#endif /* NET_CODING_BUFFER_H_ */
\ No newline at end of file
+#endif /* NET_CODING_BUFFER_H_ */
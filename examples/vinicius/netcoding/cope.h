@@ -0,0 +1,316 @@
+#ifndef NET_CODING_COPE_H_
+#define NET_CODING_COPE_H_
+
+#include "buffer.h"
+#include "packet.h"
+#include "xor.h"
+
+/* ------------------- NEIGHBORS -------------------------------------------- */
+/**
+ * @brief Number of neighbors whose holdings are tracked. When a new one is
+ * heard and all of them are in use, the least recently heard one is forgotten.
+ *
+ */
+#ifdef NETCODING_CONF_NEIGHBORS
+#define NETCODING_NEIGHBORS NETCODING_CONF_NEIGHBORS
+#else
+#define NETCODING_NEIGHBORS 8
+#endif
+
+/**
+ * @brief Number of native packet ids remembered per neighbor.
+ *
+ */
+#ifdef NETCODING_CONF_NEIGHBOR_HOLDINGS
+#define NETCODING_NEIGHBOR_HOLDINGS NETCODING_CONF_NEIGHBOR_HOLDINGS
+#else
+#define NETCODING_NEIGHBOR_HOLDINGS (NETCODING_WINDOW_SIZE * 2)
+#endif
+
+/**
+ * @brief The native packets a neighbor is known to hold, either because it
+ * sent or received them, or because it reported them. The ids are kept in a
+ * ring, so the oldest ones are forgotten first.
+ *
+ */
+typedef struct netcoding_neighbor_t {
+    netcoding_addr addr;
+    /**
+     * @brief The COPE clock value when the neighbor was last heard of. 0 means
+     * this entry is free.
+     *
+     */
+    uint32_t last_heard;
+    int next_holding;
+    uint32_t holdings[NETCODING_NEIGHBOR_HOLDINGS];
+} netcoding_neighbor;
+
+/**
+ * @brief The state of the COPE mode: what the neighbors hold and the native
+ * packets this node holds itself, needed to decode the coded ones.
+ *
+ */
+typedef struct netcoding_cope_t {
+    uint32_t clock;
+    netcoding_neighbor neighbors[NETCODING_NEIGHBORS];
+    /**
+     * @brief The native packets this node sent, received, overheard or
+     * decoded, oldest first.
+     *
+     */
+    packet_buffer held_natives;
+    struct memb held_pool;
+    uint32_t held_pool_used[MEMB_USED_WORDS(NETCODING_WINDOW_SIZE)];
+    netcoding_slot held_pool_mem[NETCODING_WINDOW_SIZE];
+    packet_index held_index;
+} netcoding_cope;
+
+static inline void init_cope(netcoding_cope* cope) {
+    cope->clock = 0;
+    memset(cope->neighbors, 0, sizeof(cope->neighbors));
+    init_pool(&cope->held_pool,
+              cope->held_pool_used,
+              cope->held_pool_mem,
+              sizeof(netcoding_slot),
+              NETCODING_WINDOW_SIZE);
+    start_indexed_list(&cope->held_natives, &cope->held_pool, &cope->held_index);
+}
+
+/**
+ * @brief Get the entry of a neighbor.
+ *
+ * @param cope
+ * @param addr
+ * @param create Whether to take a free (or else the least recently heard)
+ * entry for the neighbor if it has none.
+ * @return netcoding_neighbor* The entry or NULL if there is none.
+ */
+static netcoding_neighbor* get_neighbor(netcoding_cope* cope,
+                                        netcoding_addr addr,
+                                        int create) {
+    netcoding_neighbor* oldest = &cope->neighbors[0];
+
+    if(addr == NETCODING_ADDR_NONE) return NULL;
+
+    for(int i = 0; i < NETCODING_NEIGHBORS; i++) {
+        netcoding_neighbor* cur = &cope->neighbors[i];
+
+        if(cur->last_heard && cur->addr == addr) return cur;
+        if(!oldest->last_heard) continue;
+        if(!cur->last_heard || cur->last_heard < oldest->last_heard)
+            oldest = cur;
+    }
+    if(!create) return NULL;
+
+    oldest->addr = addr;
+    oldest->last_heard = ++cope->clock;
+    oldest->next_holding = 0;
+    memset(oldest->holdings, EMPTY_PACKET_ID, sizeof(oldest->holdings));
+    return oldest;
+}
+
+/**
+ * @brief Verifies if a neighbor is known to hold a native packet.
+ *
+ * @param cope
+ * @param addr
+ * @param packet_id
+ * @return int
+ */
+static int is_holding(netcoding_cope* cope,
+                      netcoding_addr addr,
+                      uint32_t packet_id) {
+    netcoding_neighbor* neighbor = get_neighbor(cope, addr, 0);
+
+    if(!neighbor) return 0;
+    for(int i = 0; i < NETCODING_NEIGHBOR_HOLDINGS; i++) {
+        if(neighbor->holdings[i] == packet_id) return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Records that a neighbor holds a native packet.
+ *
+ * @param cope
+ * @param addr
+ * @param packet_id
+ */
+static void learn_holding(netcoding_cope* cope,
+                          netcoding_addr addr,
+                          uint32_t packet_id) {
+    netcoding_neighbor* neighbor = get_neighbor(cope, addr, 1);
+
+    if(!neighbor || packet_id == EMPTY_PACKET_ID) return;
+    neighbor->last_heard = ++cope->clock;
+    if(is_holding(cope, addr, packet_id)) return;
+
+    neighbor->holdings[neighbor->next_holding] = packet_id;
+    neighbor->next_holding =
+        (neighbor->next_holding + 1) % NETCODING_NEIGHBOR_HOLDINGS;
+}
+
+/**
+ * @brief Counts the neighbors, but one, known to hold a native packet.
+ *
+ * @param cope
+ * @param packet_id
+ * @param excluded The neighbor not to be counted.
+ * @return int
+ */
+static int count_holders(netcoding_cope* cope,
+                         uint32_t packet_id,
+                         netcoding_addr excluded) {
+    int holders = 0;
+
+    for(int i = 0; i < NETCODING_NEIGHBORS; i++) {
+        netcoding_neighbor* cur = &cope->neighbors[i];
+
+        if(cur->last_heard && cur->addr != excluded
+           && is_holding(cope, cur->addr, packet_id))
+            holders++;
+    }
+    return holders;
+}
+
+/* ------------------- HELD PACKETS ----------------------------------------- */
+/**
+ * @brief Get a native packet this node holds.
+ *
+ * @param cope
+ * @param packet_id
+ * @return netcoding_packet* The packet or NULL if it is not held.
+ */
+static netcoding_packet* get_held_native(netcoding_cope* cope,
+                                         uint32_t packet_id) {
+    netcoding_packet key;
+
+    memset(key.header.holding_packets,
+           EMPTY_PACKET_ID,
+           sizeof(key.header.holding_packets));
+    key.header.holding_packets[0] = packet_id;
+    key.header.coefficients[0] = 1;
+    return find_packet(&cope->held_natives, &key);
+}
+
+/**
+ * @brief Keeps a native packet to decode the coded ones holding it. When all
+ * the slots are in use, the oldest packet is discarded.
+ *
+ * @param cope
+ * @param packet
+ */
+static void hold_native(netcoding_cope* cope, netcoding_packet* packet) {
+    packet_buffer* held_natives = &cope->held_natives;
+
+    if(!is_raw_packet(packet) || find_packet(held_natives, packet)) return;
+    if(!buffer_free_slots(held_natives))
+        remove_slot(held_natives, (netcoding_slot*)held_natives->head);
+    push_packet(held_natives, packet);
+}
+
+/**
+ * @brief XORs out of a coded packet every native packet this node holds. On
+ * COPE all the coefficients are 1, so removing a packet is combining it again.
+ *
+ * @param cope
+ * @param packet The packet to be reduced in place.
+ * @return int The number of packets remaining in the packet.
+ */
+static int reduce_with_held_natives(netcoding_cope* cope,
+                                    netcoding_packet* packet) {
+    netcoding_packet_header header = packet->header;
+
+    for(int i = 0; i < NUM_COMBINATIONS; i++) {
+        if(header.holding_packets[i] == EMPTY_PACKET_ID) break;
+
+        netcoding_packet* held =
+            get_held_native(cope, header.holding_packets[i]);
+        if(!held) continue;
+
+        packet->header = xor_merge_headers(&packet->header, &held->header);
+        xor_accumulate(
+            (uint8_t*)packet->body, (const uint8_t*)held->body, PAYLOAD_SIZE);
+    }
+    return get_header_num_packets(&packet->header);
+}
+
+/**
+ * @brief Verifies if a node is one of the recipients of a coded packet.
+ *
+ * @param packet
+ * @param addr
+ * @return int
+ */
+static int is_cope_recipient(netcoding_packet* packet, netcoding_addr addr) {
+    if(addr == NETCODING_ADDR_NONE) return 0;
+    for(int i = 0; i < NUM_COMBINATIONS; i++) {
+        if(packet->cope.recipients[i] == addr) return 1;
+    }
+    return 0;
+}
+
+/* ------------------- LEARNING --------------------------------------------- */
+/**
+ * @brief Learns from a packet transmission, either received or overheard:
+ * its transmitter holds the packets it combined and reported, its receiver
+ * holds the native ones and each recipient of a coded one ends up holding all
+ * of them. This node keeps the native packets, including the ones it can
+ * decode, to decode future coded packets.
+ *
+ * @param cope
+ * @param sender The transmitter of the packet.
+ * @param receiver The link-layer receiver of the packet.
+ * @param packet
+ */
+static void learn_from_packet(netcoding_cope* cope,
+                              netcoding_addr sender,
+                              netcoding_addr receiver,
+                              netcoding_packet* packet) {
+    netcoding_packet_header* header = &packet->header;
+
+    for(int i = 0; i < NETCODING_REPORT_SIZE; i++)
+        learn_holding(cope, sender, packet->cope.reports[i]);
+    for(int i = 0; i < get_header_num_packets(header); i++)
+        learn_holding(cope, sender, header->holding_packets[i]);
+
+    if(is_raw_packet(packet)) {
+        learn_holding(cope, receiver, header->holding_packets[0]);
+        hold_native(cope, packet);
+        return;
+    }
+
+    for(int r = 0; r < NUM_COMBINATIONS; r++) {
+        for(int i = 0; i < get_header_num_packets(header); i++) {
+            learn_holding(
+                cope, packet->cope.recipients[r], header->holding_packets[i]);
+        }
+    }
+
+    netcoding_packet reduced = *packet;
+    if(reduce_with_held_natives(cope, &reduced) == 1)
+        hold_native(cope, &reduced);
+}
+
+/**
+ * @brief Fills the reception reports of a packet about to be transmitted with
+ * the latest native packets this node holds.
+ *
+ * @param cope
+ * @param packet
+ */
+static void fill_reception_reports(netcoding_cope* cope,
+                                   netcoding_packet* packet) {
+    linked_list_node* cur_node = cope->held_natives.tail;
+
+    for(int i = 0; i < NETCODING_REPORT_SIZE; i++) {
+        netcoding_packet* held = cur_node ? (netcoding_packet*)cur_node->data
+                                          : NULL;
+
+        packet->cope.reports[i] =
+            held ? held->header.holding_packets[0] : EMPTY_PACKET_ID;
+        if(cur_node) cur_node = cur_node->prev;
+    }
+}
+
+#endif /* NET_CODING_COPE_H_ */
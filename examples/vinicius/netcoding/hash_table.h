@@ -3,172 +3,216 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include "packet.h"
 #include "string.h"
 
-typedef struct hash_table_t {
-    int capacity;
-    int size;
-
-    size_t* keys;
-    void** items;
-
-    int (*collision_detector)(void*, void*);
-    size_t (*hash_calculator)(void*);
-    void (*item_copier)(void*, void**);
-    void** (*vector_alocator)(int);
-} hash_table;
-
-static hash_table create_hash_table(int capacity,
-                                    int (*collision_detector)(void*, void*),
-                                    void** (*vector_alocator)(int),
-                                    size_t (*hash_calculator)(void*),
-                                    void (*item_copier)(void*, void**)) {
-    hash_table map;
-
-    map.capacity = capacity;
-    map.size = 0;
-    map.keys = (size_t*)malloc(capacity * sizeof(size_t));
-    for(int i = 0; i < capacity; i++) map.keys[i] = 0;
-    map.items = vector_alocator(capacity);
-    map.hash_calculator = hash_calculator;
-    map.collision_detector = collision_detector;
-    map.item_copier = item_copier;
-    map.vector_alocator = vector_alocator;
-
-    return map;
-}
+/**
+ * @brief Number of slots of a header set. It must be a power of two, so the
+ * probe sequence wraps with a mask.
+ *
+ */
+#ifdef NETCODING_CONF_HEADER_SET_CAPACITY
+#define HEADER_SET_CAPACITY NETCODING_CONF_HEADER_SET_CAPACITY
+#else
+#define HEADER_SET_CAPACITY 64
+#endif
 
-static int insert_item_without_resize(hash_table* hash_table, void* item) {
-    size_t hash = hash_table->hash_calculator(item);
-    int index = hash % hash_table->capacity;
+#if HEADER_SET_CAPACITY & (HEADER_SET_CAPACITY - 1)
+#error "HEADER_SET_CAPACITY must be a power of two"
+#endif
 
-    for(int i = 0; i < hash_table->capacity; i++) {
-        int next_index = (index + i) % hash_table->capacity;
+/**
+ * @brief The most slots in use, counting the tombstones, so the probe
+ * sequences stay short: 3/4 of the capacity.
+ *
+ */
+#define HEADER_SET_MAX_LOAD (HEADER_SET_CAPACITY - HEADER_SET_CAPACITY / 4)
 
-        // Empty slot
-        if(hash_table->keys[next_index] == 0) {
-            hash_table->keys[next_index] = hash;
-            hash_table->item_copier(item, &hash_table->items[next_index]);
-            hash_table->size++;
-            return 1;
-        }
-        // Verify if both items are equal
-        if(hash_table->collision_detector(item, hash_table->items[next_index]))
-            return 2;
-    }
+#define HEADER_SET_EMPTY 0
+#define HEADER_SET_FULL 1
+#define HEADER_SET_TOMBSTONE 2
 
-    return 0;
+/**
+ * @brief An open addressing (linear probing) set of packet headers over fixed
+ * storage. Since the headers are sorted, each combination has a single
+ * canonical header, so equal combinations are found by comparing them. The
+ * headers are kept inline and removed ones leave a tombstone behind, so the
+ * probe sequences going through them are not broken.
+ *
+ */
+typedef struct header_set_t {
+    int size;
+    int tombstones;
+    uint8_t states[HEADER_SET_CAPACITY];
+    netcoding_packet_header headers[HEADER_SET_CAPACITY];
+} header_set;
+
+static inline void init_header_set(header_set* set) {
+    set->size = 0;
+    set->tombstones = 0;
+    memset(set->states, HEADER_SET_EMPTY, sizeof(set->states));
 }
 
-static void resize_hash_table(hash_table* hash_table,
-                              int new_size,
-                              int old_size) {
-    size_t *old_keys = hash_table->keys,
-           *new_keys = (size_t*)malloc(new_size * sizeof(size_t));
-    for(int i = 0; i < new_size; i++) new_keys[i] = 0;
-    void **old_items = hash_table->items,
-         **new_items = hash_table->vector_alocator(new_size);
-
-    hash_table->keys = new_keys;
-    hash_table->items = new_items;
-    hash_table->size = 0;
-    hash_table->capacity = new_size;
-
-    for(int i = 0; i < old_size; i++) {
-        if(old_keys[i]) {
-            insert_item_without_resize(hash_table, old_items[i]);
-        }
+/**
+ * @brief Hashes a header, mixing every packet id and coefficient of it with
+ * the MurmurHash3 finalizer, so permutations and near ids spread over the
+ * whole table.
+ *
+ * @param header
+ * @return uint32_t
+ */
+static uint32_t hash_header(netcoding_packet_header* header) {
+    uint32_t hash = 0x9E3779B9u;
+
+    for(int i = 0; i < NUM_COMBINATIONS; i++) {
+        if(header->holding_packets[i] == EMPTY_PACKET_ID) break;
+
+        hash ^= header->holding_packets[i] + 0x9E3779B9u + (hash << 6)
+                + (hash >> 2);
+        hash ^= (uint32_t)header->coefficients[i] << 24;
+        hash ^= hash >> 16;
+        hash *= 0x85EBCA6Bu;
+        hash ^= hash >> 13;
+        hash *= 0xC2B2AE35u;
+        hash ^= hash >> 16;
     }
-
-    free(old_items);
-    free(old_keys);
+    return hash;
 }
 
 /**
- * @brief Tries to insert a item into the hash table.
+ * @brief Get the slot of a header in a set.
  *
- * @param hash_table
- * @param item
- * @return int 0 if didn't insert the item, 1 if inserted and 2 if the item was
- * already there.
+ * @param set
+ * @param header
+ * @param free_slot Where the first free slot of the probe sequence is written,
+ * a tombstone or the empty slot ending it, or -1 if there is none. It may be
+ * NULL.
+ * @return int The slot or -1 if the header is not in the set.
  */
-static int try_insert_item(hash_table* hash_table, void* item) {
-    if(hash_table->size + 1 > hash_table->capacity / 2)
-        resize_hash_table(
-            hash_table, hash_table->capacity * 2, hash_table->capacity);
-
-    size_t hash = hash_table->hash_calculator(item);
-    int index = hash % hash_table->capacity;
-
-    for(int i = 0; i < hash_table->capacity; i++) {
-        int next_index = (index + i) % hash_table->capacity;
-
-        // Empty slot
-        if(hash_table->keys[next_index] == 0) {
-            hash_table->keys[next_index] = hash;
-            hash_table->item_copier(item, &hash_table->items[next_index]);
-            hash_table->size++;
-            return 1;
+static int find_header_slot(header_set* set,
+                            netcoding_packet_header* header,
+                            int* free_slot) {
+    uint32_t index = hash_header(header);
+
+    if(free_slot) *free_slot = -1;
+    for(int i = 0; i < HEADER_SET_CAPACITY; i++) {
+        int slot = (index + i) & (HEADER_SET_CAPACITY - 1);
+
+        if(set->states[slot] == HEADER_SET_FULL) {
+            if(are_equivalent_headers(&set->headers[slot], header)) return slot;
+            continue;
         }
-        // Verify if both items are equal
-        if(hash_table->collision_detector(item, hash_table->items[next_index]))
-            return 2;
+        if(free_slot && *free_slot < 0) *free_slot = slot;
+        // Didn't find until now, then it is not here
+        if(set->states[slot] == HEADER_SET_EMPTY) return -1;
     }
+    return -1;
+}
 
-    return 0;
+/**
+ * @brief Verifies if a header is in a set.
+ *
+ * @param set
+ * @param header
+ * @return int
+ */
+static inline int has_header(header_set* set, netcoding_packet_header* header) {
+    return find_header_slot(set, header, NULL) >= 0;
 }
 
 /**
- * @brief
+ * @brief Tries to insert a header into a set, reusing the first tombstone of
+ * its probe sequence if there is any.
  *
- * @param hash_table
- * @param item
- * @return void* NULL if not found, the pointer to the data otherwise
+ * @param set
+ * @param header
+ * @return int 0 if didn't insert the header (the set is full), 1 if inserted
+ * and 2 if the header was already there.
  */
-static void* find_item(hash_table* hash_table, void* item) {
-    size_t hash = hash_table->hash_calculator(item);
-    int index = hash % hash_table->capacity;
+static int insert_header(header_set* set, netcoding_packet_header* header) {
+    int free_slot;
+
+    if(find_header_slot(set, header, &free_slot) >= 0) return 2;
+    if(free_slot < 0) return 0;
+    if(set->states[free_slot] == HEADER_SET_TOMBSTONE)
+        set->tombstones--;
+    else if(set->size + set->tombstones >= HEADER_SET_MAX_LOAD)
+        return 0;
+
+    set->states[free_slot] = HEADER_SET_FULL;
+    set->headers[free_slot] = *header;
+    set->size++;
+    return 1;
+}
 
-    for(int i = 0; i < hash_table->capacity; i++) {
-        int next_index = (index + i) % hash_table->capacity;
+/**
+ * @brief Removes the header of a slot. The slot becomes a tombstone unless
+ * it ends a probe sequence (the next slot is empty), in which case it and the
+ * tombstones right before it become empty again.
+ *
+ * @param set
+ * @param slot
+ */
+static void remove_header_slot(header_set* set, int slot) {
+    const int mask = HEADER_SET_CAPACITY - 1;
+
+    set->size--;
+    if(set->states[(slot + 1) & mask] != HEADER_SET_EMPTY) {
+        set->states[slot] = HEADER_SET_TOMBSTONE;
+        set->tombstones++;
+        return;
+    }
 
-        // Didn't find until now, then it is not here
-        if(hash_table->keys[next_index] == 0) return NULL;
-        if(hash_table->keys[next_index] == hash
-           && hash_table->collision_detector(hash_table->items[next_index],
-                                             item))
-            return hash_table->items[next_index];
+    set->states[slot] = HEADER_SET_EMPTY;
+    for(slot = (slot - 1) & mask;
+        set->states[slot] == HEADER_SET_TOMBSTONE;
+        slot = (slot - 1) & mask) {
+        set->states[slot] = HEADER_SET_EMPTY;
+        set->tombstones--;
     }
+}
 
-    return NULL;
+/**
+ * @brief Removes a header from a set.
+ *
+ * @param set
+ * @param header
+ * @return int 1 if the header was removed and 0 if it was not there.
+ */
+static int remove_header(header_set* set, netcoding_packet_header* header) {
+    int slot = find_header_slot(set, header, NULL);
+
+    if(slot < 0) return 0;
+    remove_header_slot(set, slot);
+    return 1;
 }
 
-static void clean_hash_table(hash_table* hash_table) {
-    for(int i = 0; i < hash_table->capacity; i++) {
-        if(hash_table->keys[i] != 0) {
-            free(hash_table->items[i]);
-        }
+/**
+ * @brief Removes from a set every header of a generation.
+ *
+ * @param set
+ * @param generation
+ */
+static void remove_generation_headers(header_set* set, uint32_t generation) {
+    for(int slot = 0; slot < HEADER_SET_CAPACITY && set->size; slot++) {
+        if(set->states[slot] == HEADER_SET_FULL
+           && get_header_generation(&set->headers[slot]) == generation)
+            remove_header_slot(set, slot);
     }
-
-    free(hash_table->keys);
-    free(hash_table->items);
+    // Nothing left to probe through
+    if(!set->size) init_header_set(set);
 }
 
-static void print_hash_table(hash_table* hash_table) {
-    printf("HashTable: {\n");
-    for(int i = 0; i < hash_table->capacity; i++) {
-        if(hash_table->keys[i]) {
-            printf("\t[%lu] -> ", hash_table->keys[i]);
-            netcoding_packet* packet =
-                ((netcoding_packet**)hash_table->items)[i];
-            print_packet_str(packet);
+static inline void print_header_set(header_set* set) {
+    printf("HeaderSet: {\n");
+    for(int i = 0; i < HEADER_SET_CAPACITY; i++) {
+        if(set->states[i] == HEADER_SET_FULL) {
+            printf("\t[%d] -> ", i);
+            print_header(&set->headers[i]);
             printf("\n");
         }
-        else {
-            printf("\t[0] -> NULL\n");
-        }
     }
     printf("}\n");
 }
 
-#endif /* HASH_TABLE_H_ */
\ No newline at end of file
+#endif /* HASH_TABLE_H_ */
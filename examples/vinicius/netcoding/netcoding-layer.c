@@ -0,0 +1,427 @@
+#include "netcoding-layer.h"
+
+#include "contiki-net.h"
+#include "lib/assert.h"
+#include "net/ipv6/simple-udp.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include "net/ipv6/uipbuf.h"
+#include "net/link-stats.h"
+#include "net/packetbuf.h"
+#include "net/queuebuf.h"
+#include "netcoding.h"
+#include "utils.h"
+
+netcoding_node network_coding_node;
+
+/* The network coding packet travels as the UDP payload of a datagram that may
+ * also carry an 8-byte hop-by-hop option, e.g. the RPL one */
+static_assert(NETCODING_MAX_PACKET_SIZE <= UIP_BUFSIZE - UIP_IPUDPH_LEN - 8,
+              "PAYLOAD_SIZE does not fit in the IPv6 MTU");
+
+/* Whether a flushed packet is being sent, so it is not encoded again */
+static int flushing;
+
+/* Connection the acknowledgments are flooded through */
+static struct simple_udp_connection ack_conn;
+
+#if NETCODING_COPE
+/* The native packet last decoded out of an overheard coded packet of crossing
+ * flows, which is addressed to this node instead of the coded packet
+ * destination */
+static uint32_t local_delivery = EMPTY_PACKET_ID;
+
+/* The native packet last decoded out of an overheard frame, whose UDP checksum
+ * still covers the coded payload */
+static uint32_t overheard_packet = EMPTY_PACKET_ID;
+#endif
+
+/* ------------------- ROUTES ----------------------------------------------- */
+/**
+ * @brief Get where the datagram in uip_buf is being routed to: its destination
+ * and the neighbor it is about to be sent to, the destination itself when it
+ * is a neighbor, the next hop of its route or else the default router, and
+ * how good the link towards it is.
+ *
+ * @param route
+ * @param udp_header The UDP header of the datagram.
+ */
+static void get_route(netcoding_route* route, struct uip_udp_hdr* udp_header) {
+    const uip_ipaddr_t* nexthop = &UIP_IP_BUF->destipaddr;
+    const uip_lladdr_t* lladdr = NULL;
+    const struct link_stats* stats = NULL;
+
+    route->destination = NETCODING_ADDR(UIP_IP_BUF->destipaddr.u8, 16);
+    memcpy(route->source_ip, UIP_IP_BUF->srcipaddr.u8, 16);
+    memcpy(route->destination_ip, UIP_IP_BUF->destipaddr.u8, 16);
+    route->hop_limit = UIP_IP_BUF->ttl;
+    route->source_port = udp_header->srcport;
+    route->destination_port = udp_header->destport;
+    if(uip_ds6_nbr_lookup(nexthop) == NULL) {
+        uip_ds6_route_t* entry = uip_ds6_route_lookup(nexthop);
+
+        nexthop = entry ? uip_ds6_route_nexthop(entry) : uip_ds6_defrt_choose();
+    }
+    if(nexthop != NULL) lladdr = uip_ds6_nbr_lladdr_from_ipaddr(nexthop);
+    route->next_hop = lladdr != NULL
+                          ? NETCODING_ADDR(lladdr->addr, LINKADDR_SIZE)
+                          : NETCODING_ADDR_NONE;
+    if(lladdr != NULL) stats = link_stats_from_lladdr((const linkaddr_t*)lladdr);
+    route->etx = stats != NULL ? stats->etx : 0;
+    route->backlog = QUEUEBUF_NUM - queuebuf_numfree();
+}
+
+/* ------------------- TRANSMISSION ----------------------------------------- */
+/**
+ * @brief Sends a packet withheld by the network coding once its hold timer
+ * expires (the netcoding_node transmit callback). The datagram is rebuilt in
+ * uip_buf out of the source, destination and hop limit it came with, so the
+ * packet is still forwarded on behalf of its source, and then goes out as
+ * any datagram does, the routing extension headers included.
+ *
+ * @param packet
+ * @param route
+ */
+static void transmit(netcoding_packet* packet, netcoding_route* route) {
+    struct uip_udp_hdr* udp_header =
+        (struct uip_udp_hdr*)(uip_buf + UIP_IPH_LEN);
+    int len;
+
+    uipbuf_clear();
+    UIP_IP_BUF->vtc = 0x60;
+    UIP_IP_BUF->tcflow = 0x00;
+    UIP_IP_BUF->flow = 0x00;
+    UIP_IP_BUF->proto = UIP_PROTO_UDP;
+    UIP_IP_BUF->ttl = route->hop_limit;
+    memcpy(UIP_IP_BUF->srcipaddr.u8, route->source_ip, 16);
+    memcpy(UIP_IP_BUF->destipaddr.u8, route->destination_ip, 16);
+    udp_header->srcport = route->source_port;
+    udp_header->destport = route->destination_port;
+
+    len = pack_packet(packet, (uint8_t*)udp_header + UIP_UDPH_LEN);
+    uip_len = UIP_IPUDPH_LEN + len;
+    uipbuf_set_len_field(UIP_IP_BUF, uip_len - UIP_IPH_LEN);
+    udp_header->udplen = UIP_HTONS(UIP_UDPH_LEN + len);
+    udp_header->udpchksum = 0;
+#if UIP_UDP_CHECKSUMS
+    udp_header->udpchksum = ~uip_udpchksum();
+    if(udp_header->udpchksum == 0) udp_header->udpchksum = 0xffff;
+#endif
+
+    flushing = 1;
+    tcpip_ipv6_output();
+    flushing = 0;
+    NETCODING_EVENT(&network_coding_node.stats,
+                    NETCODING_EVENT_SENT,
+                    packet->header.holding_packets[0]);
+}
+
+/**
+ * @brief Writes a packet back into uip_buf, updating the datagram lengths
+ * and the UDP checksum, since its header size and payload change. The payload
+ * is usually already in place, combined right inside uip_buf, so it is only
+ * moved when the header size changes, and not copied at all if the packet was
+ * routed as it came. The lengths and checksum are then only refreshed if the
+ * datagram is dirty.
+ *
+ * @param udp_header The UDP header of the datagram, followed by the packet.
+ * @param packet The header of the packet.
+ * @param body Its payload, inside uip_buf or not.
+ * @param dirty Whether the datagram changed besides the packet, e.g. its
+ * destination or a payload decoded when overheard, so its checksum is stale
+ * even if the packet is unchanged.
+ */
+static void write_packet(struct uip_udp_hdr* udp_header,
+                         netcoding_packet* packet,
+                         const char* body,
+                         int dirty) {
+    uint8_t* data = (uint8_t*)udp_header + UIP_UDPH_LEN;
+    uint8_t header[NETCODING_MAX_HEADER_SIZE];
+    int header_size = pack_packet_header(packet, header);
+    int len = header_size + PAYLOAD_SIZE;
+
+    int in_place = (const uint8_t*)body == data + header_size
+                   && !memcmp(data, header, header_size);
+
+    if(in_place && !dirty) return;
+    if(!in_place) {
+        // The header may grow over the current payload, so it is written last
+        if((const uint8_t*)body != data + header_size)
+            memmove(data + header_size, body, PAYLOAD_SIZE);
+        memcpy(data, header, header_size);
+    }
+
+    uip_len = data - uip_buf + len;
+    uipbuf_set_len_field(UIP_IP_BUF, uip_len - UIP_IPH_LEN);
+    udp_header->udplen = UIP_HTONS(UIP_UDPH_LEN + len);
+#if UIP_UDP_CHECKSUMS
+    // The checksum walks the extension headers through uip_ext_len
+    uint16_t ext_len = uip_ext_len;
+
+    uip_ext_len = (uint8_t*)udp_header - uip_buf - UIP_IPH_LEN;
+    udp_header->udpchksum = 0;
+    udp_header->udpchksum = ~uip_udpchksum();
+    if(udp_header->udpchksum == 0) udp_header->udpchksum = 0xffff;
+    uip_ext_len = ext_len;
+#endif
+}
+
+#if NETCODING_COPE
+/**
+ * @brief Readdresses the datagram in uip_buf to this node, so tcpip delivers
+ * it locally instead of forwarding it.
+ *
+ */
+static void deliver_locally(void) {
+    uip_ds6_addr_t* addr = uip_ds6_get_global(ADDR_PREFERRED);
+
+    if(addr == NULL) addr = uip_ds6_get_link_local(-1);
+    if(addr != NULL) uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, &addr->ipaddr);
+}
+#endif
+
+/* ------------------- ACKNOWLEDGMENTS -------------------------------------- */
+/**
+ * @brief Sends an acknowledgment to every neighbor.
+ *
+ * @param receiver
+ * @param base
+ * @param decoded_ahead
+ */
+static void broadcast_ack(netcoding_addr receiver,
+                          uint32_t base,
+                          uint32_t decoded_ahead) {
+    uint8_t data[NETCODING_ACK_MAX_SIZE];
+    uip_ipaddr_t addr;
+
+    uip_create_linklocal_allnodes_mcast(&addr);
+    simple_udp_sendto(&ack_conn,
+                      data,
+                      pack_ack(receiver, base, decoded_ahead, data),
+                      &addr);
+}
+
+/**
+ * @brief Slides the coding window on a received acknowledgment and, if it is
+ * new, forwards it to the neighbors, so it floods the network once.
+ *
+ */
+static void ack_callback(struct simple_udp_connection* c,
+                         const uip_ipaddr_t* sender_addr,
+                         uint16_t sender_port,
+                         const uip_ipaddr_t* receiver_addr,
+                         uint16_t receiver_port,
+                         const uint8_t* data,
+                         uint16_t datalen) {
+    netcoding_addr receiver;
+    uint32_t base, decoded_ahead;
+
+    if(!unpack_ack(data, datalen, &receiver, &base, &decoded_ahead)) return;
+    if(acknowledge_generations(
+           &network_coding_node, receiver, base, decoded_ahead))
+        broadcast_ack(receiver, base, decoded_ahead);
+}
+
+void netcoding_layer_init(void) {
+    simple_udp_register(
+        &ack_conn, NETCODING_ACK_PORT, NULL, NETCODING_ACK_PORT, ack_callback);
+#if BUILD_WITH_SHELL
+    netcoding_shell_init();
+#endif
+}
+
+void netcoding_layer_acknowledge(void) {
+    netcoding_decoder* decoder = &network_coding_node.decoder;
+    // The routes name a receiver after the last bytes of its address
+    uip_ds6_addr_t* addr = uip_ds6_get_link_local(-1);
+
+    if(addr == NULL) return;
+
+    netcoding_addr self = NETCODING_ADDR(addr->ipaddr.u8, 16);
+    if(acknowledge_generations(&network_coding_node,
+                               self,
+                               decoder->acked_generation,
+                               decoder->decoded_ahead))
+        broadcast_ack(self, decoder->acked_generation, decoder->decoded_ahead);
+}
+
+/* ------------------- OUTPUT ----------------------------------------------- */
+/**
+ * @brief Get the UDP header of the datagram in uip_buf, walking its extension
+ * headers.
+ *
+ * @return struct uip_udp_hdr* The header or NULL if it is not a UDP datagram.
+ */
+static struct uip_udp_hdr* get_udp_header(void) {
+    uint8_t protocol;
+    uint8_t* header = uipbuf_get_last_header(uip_buf, uip_len, &protocol);
+
+    if(header == NULL || protocol != UIP_PROTO_UDP) return NULL;
+    return (struct uip_udp_hdr*)header;
+}
+
+int netcoding_layer_output(void) {
+    netcoding_packet packet;
+    netcoding_route route;
+    struct uip_udp_hdr* udp_header;
+    uint8_t* data;
+    char* body;
+    int len;
+    int dirty = 0;
+
+    if(flushing || (udp_header = get_udp_header()) == NULL) return 1;
+
+    data = (uint8_t*)udp_header + UIP_UDPH_LEN;
+    len = uip_len - (data - uip_buf);
+    // Only the header is parsed, the payload is coded right inside uip_buf
+    if(!IS_NETCODING_PACKET(data, len)
+       || !unpack_packet_header(data, len, &packet))
+        return 1;
+    body = (char*)NETCODING_PACKET_BODY(data, len);
+
+#if NETCODING_LOG_LEVEL >= LOG_LEVEL_DBG
+    netcoding_log_format(
+        "OUTPUT", network_coding_node.id, 1, &UIP_IP_BUF->srcipaddr);
+    printf("Header: [");
+    print_header(&packet.header);
+    printf("]\n");
+#endif
+
+    network_coding_node.transmit = transmit;
+    get_route(&route, udp_header);
+#if NETCODING_COPE
+    if(network_coding_node.mode == NETCODING_MODE_COPE) {
+        netcoding_addr sender = NETCODING_ADDR_NONE;
+        netcoding_addr self =
+            NETCODING_ADDR(linkaddr_node_addr.u8, LINKADDR_SIZE);
+
+        // Rewritten with its decoded payload when it was overheard
+        if(is_raw_packet(&packet)
+           && packet.header.holding_packets[0] == overheard_packet) {
+            overheard_packet = EMPTY_PACKET_ID;
+            dirty = 1;
+        }
+
+        // COPE learns from and keeps whole packets
+        memcpy(packet.body, body, PAYLOAD_SIZE);
+        body = packet.body;
+
+        if(!uip_ds6_is_my_addr(&UIP_IP_BUF->srcipaddr)) {
+            sender = NETCODING_ADDR(
+                packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8, LINKADDR_SIZE);
+        }
+        learn_from_packet(&network_coding_node.cope, sender, self, &packet);
+#if NETCODING_BROADCAST
+        int crossing = packet.cope.crossing;
+
+        // Every neighbor receives the broadcast, only the recipients forward
+        if(sender != NETCODING_ADDR_NONE
+           && get_header_num_packets(&packet.header) > 1
+           && !is_cope_recipient(&packet, self)) {
+            NETCODING_EVENT(&network_coding_node.stats,
+                            NETCODING_EVENT_DROPPED,
+                            packet.header.holding_packets[0]);
+            return 0;
+        }
+#endif
+
+        // Every packet of it was already forwarded by this node
+        if(!decode_cope_packet(&network_coding_node, self, &packet)) {
+            NETCODING_EVENT(&network_coding_node.stats,
+                            NETCODING_EVENT_DROPPED,
+                            packet.header.holding_packets[0]);
+            return 0;
+        }
+#if NETCODING_BROADCAST
+        if(crossing && is_raw_packet(&packet))
+            local_delivery = packet.header.holding_packets[0];
+#endif
+
+        // This node is the destination of its packet of crossing flows
+        if(is_raw_packet(&packet) && local_delivery != EMPTY_PACKET_ID
+           && packet.header.holding_packets[0] == local_delivery) {
+            local_delivery = EMPTY_PACKET_ID;
+            // Its destination is part of the checksum pseudo-header
+            deliver_locally();
+            write_packet(udp_header, &packet, body, 1);
+            return 1;
+        }
+    }
+#endif
+
+    // Withheld to be combined later
+    if(!encode_packet_view(&network_coding_node, &packet, body, &route))
+        return 0;
+
+    write_packet(udp_header, &packet, body, dirty);
+    NETCODING_EVENT(&network_coding_node.stats,
+                    NETCODING_EVENT_SENT,
+                    packet.header.holding_packets[0]);
+#if NETCODING_BROADCAST
+    if(network_coding_node.mode == NETCODING_MODE_COPE
+       && packet.cope.recipients[1] != NETCODING_ADDR_NONE)
+        return TCPIP_OUTPUT_HOOK_BROADCAST;
+#endif
+    return 1;
+}
+
+/* ------------------- MAC -------------------------------------------------- */
+int netcoding_is_coded_frame(void) {
+    netcoding_packet packet;
+    uint8_t* frame = (uint8_t*)packetbuf_dataptr();
+    int start = find_packet_start(frame, packetbuf_datalen());
+
+    return start >= 0
+           && unpack_packet_header(
+               frame + start, packetbuf_datalen() - start, &packet)
+           && get_header_num_packets(&packet.header) > 1;
+}
+
+/* ------------------- OVERHEARING ------------------------------------------ */
+#if NETCODING_COPE
+/**
+ * @brief It learns from the network coding packets exchanged by the neighbors
+ * and, if this node is a recipient of an overheard coded packet, decodes its
+ * native packet and has the frame processed as if addressed to this node, so
+ * it is forwarded, or delivered if it belongs to crossing flows. The network
+ * coding packet is the (not compressed) UDP payload, then the end of the
+ * frame, unless the frame is a 6LoWPAN fragment. It is found from there
+ * through its header size. Its UDP checksum, compressed in the frame, is
+ * refreshed once the datagram reaches `netcoding_layer_output`.
+ *
+ */
+int netcoding_overhear(void) {
+    netcoding_packet packet;
+    uint8_t* frame = (uint8_t*)packetbuf_dataptr();
+    int start = find_packet_start(frame, packetbuf_datalen());
+    int len = packetbuf_datalen() - start;
+    netcoding_addr self = NETCODING_ADDR(linkaddr_node_addr.u8, LINKADDR_SIZE);
+
+    if(network_coding_node.mode != NETCODING_MODE_COPE || start < 0
+       || !unpack_packet(frame + start, len, &packet))
+        return 0;
+
+    learn_from_packet(
+        &network_coding_node.cope,
+        NETCODING_ADDR(packetbuf_addr(PACKETBUF_ADDR_SENDER)->u8,
+                       LINKADDR_SIZE),
+        NETCODING_ADDR(packetbuf_addr(PACKETBUF_ADDR_RECEIVER)->u8,
+                       LINKADDR_SIZE),
+        &packet);
+    int crossing = packet.cope.crossing;
+
+    if(get_header_num_packets(&packet.header) < 2
+       || decode_cope_packet(&network_coding_node, self, &packet) != 1)
+        return 0;
+    if(crossing) local_delivery = packet.header.holding_packets[0];
+
+    // The decoded packet holds fewer ids, so it is not any longer
+    uint8_t data[NETCODING_MAX_PACKET_SIZE];
+    int decoded_len = pack_packet(&packet, data);
+
+    if(decoded_len > len) return 0;
+    memcpy(frame + start, data, decoded_len);
+    packetbuf_set_datalen(start + decoded_len);
+    overheard_packet = packet.header.holding_packets[0];
+    return 1;
+}
+#endif
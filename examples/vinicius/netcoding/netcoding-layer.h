@@ -0,0 +1,82 @@
+#ifndef NET_CODING_LAYER_H_
+#define NET_CODING_LAYER_H_
+
+/**
+ * @brief The network coding layer, between IPv6 and the MAC. It is built as
+ * a module by including Makefile.netcoding, which hooks it into the output of
+ * every datagram (TCPIP_CONF_OUTPUT_HOOK), independently of the routing
+ * protocol and of the MAC.
+ *
+ */
+
+/**
+ * @brief The UDP port of the cumulative decoding acknowledgments, which are
+ * flooded back from the receivers to every node.
+ *
+ */
+#ifdef NETCODING_CONF_ACK_PORT
+#define NETCODING_ACK_PORT NETCODING_CONF_ACK_PORT
+#else
+#define NETCODING_ACK_PORT 3300
+#endif
+
+/**
+ * @brief Starts listening to the acknowledgments. It must be called once by
+ * every node, after `create_netcoding_node`.
+ *
+ */
+void netcoding_layer_init(void);
+
+/**
+ * @brief Registers the netcoding shell command (netcoding-shell.c), reading
+ * the event counters and the trace ring. `netcoding_layer_init` calls it when
+ * the shell is built in.
+ *
+ */
+void netcoding_shell_init(void);
+
+/**
+ * @brief Announces the generations the decoder of this node fully decoded, if
+ * they changed since the last announcement. Receivers call it after decoding.
+ *
+ */
+void netcoding_layer_acknowledge(void);
+
+/**
+ * @brief Output hook (TCPIP_CONF_OUTPUT_HOOK), called with every outgoing
+ * datagram, originated or forwarded. Only the UDP datagrams carrying a network
+ * coding packet are handled, the others are left untouched: the packet is
+ * encoded in place or withheld to be combined with a later one.
+ *
+ * @return int 0 if the datagram must not be sent now,
+ * TCPIP_OUTPUT_HOOK_BROADCAST if it carries a COPE coded packet to be
+ * broadcast (NETCODING_BROADCAST) and 1 otherwise.
+ */
+int netcoding_layer_output(void);
+
+/**
+ * @brief Callback of the CSMA and TSCH overhearing
+ * (CSMA_CONF_OVERHEARING_CALLBACK and TSCH_CALLBACK_OVERHEARD), for the COPE
+ * mode.
+ *
+ * @return int 1 if the frame must be processed and 0 otherwise.
+ */
+int netcoding_overhear(void);
+
+/**
+ * @brief Verifies if the frame in packetbuf carries a coded packet, i.e.,
+ * holding more than one native packet.
+ *
+ * @return int
+ */
+int netcoding_is_coded_frame(void);
+
+/**
+ * @brief The Orchestra rule scheduling the coded frames in shared cells, which
+ * every next hop listens to (orchestra-rule-netcoding.c).
+ *
+ */
+struct orchestra_rule;
+extern struct orchestra_rule netcoding_coded_cells;
+
+#endif /* NET_CODING_LAYER_H_ */
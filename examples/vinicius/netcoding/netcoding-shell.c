@@ -0,0 +1,101 @@
+#include "contiki.h"
+
+#if BUILD_WITH_SHELL
+
+#include <string.h>
+#include "netcoding-layer.h"
+#include "netcoding.h"
+#include "services/shell/shell.h"
+#include "services/shell/shell-commands.h"
+
+/**
+ * @brief The netcoding shell command, reading the event counters and trace
+ * ring of this node (stats.h), e.g. "netcoding", "netcoding trace" or
+ * "netcoding reset".
+ *
+ */
+
+/* ------------------- COMMANDS --------------------------------------------- */
+static void print_counters(shell_output_func output) {
+    netcoding_stats* stats = &network_coding_node.stats;
+
+    SHELL_OUTPUT(output, "Network coding events:\n");
+    for(int i = 0; i < NETCODING_NUM_EVENTS; i++) {
+        SHELL_OUTPUT(output,
+                     "-- %-15s %lu\n",
+                     netcoding_event_names[i],
+                     (unsigned long)stats->counters[i]);
+    }
+    SHELL_OUTPUT(output,
+                 "-- withheld        %d raw, %d combined\n",
+                 network_coding_node.raw_buffer.size,
+                 network_coding_node.combination_buffer.size);
+}
+
+static void print_trace(shell_output_func output) {
+#if NETCODING_LOG_LEVEL >= LOG_LEVEL_WARN
+    netcoding_stats* stats = &network_coding_node.stats;
+
+    SHELL_OUTPUT(output, "Network coding trace, oldest first:\n");
+    for(int age = stats->trace_size - 1; age >= 0; age--) {
+        netcoding_trace_entry* entry = get_trace_entry(stats, age);
+
+        SHELL_OUTPUT(output,
+                     "-- %lu %s %lu\n",
+                     (unsigned long)entry->time,
+                     netcoding_event_names[entry->event],
+                     (unsigned long)entry->packet_id);
+    }
+#else
+    SHELL_OUTPUT(output,
+                 "The trace needs NETCODING_CONF_LOG_LEVEL LOG_LEVEL_WARN or "
+                 "above\n");
+#endif
+}
+
+static PT_THREAD(cmd_netcoding(struct pt* pt,
+                               shell_output_func output,
+                               char* args)) {
+    char* next_args;
+
+    PT_BEGIN(pt);
+
+    SHELL_ARGS_INIT(args, next_args);
+    SHELL_ARGS_NEXT(args, next_args);
+
+    if(args == NULL) {
+        print_counters(output);
+    }
+    else if(!strcmp(args, "trace")) {
+        print_trace(output);
+    }
+    else if(!strcmp(args, "reset")) {
+        init_stats(&network_coding_node.stats);
+        SHELL_OUTPUT(output, "Network coding events reset\n");
+    }
+    else {
+        SHELL_OUTPUT(output, "Usage: netcoding [trace|reset]\n");
+    }
+
+    PT_END(pt);
+}
+
+/* ------------------- REGISTRATION ----------------------------------------- */
+static const struct shell_command_t netcoding_commands[] = {
+    {"netcoding",
+     cmd_netcoding,
+     "'> netcoding [trace|reset]': Shows the network coding event counters, "
+     "the trace ring or resets them"},
+    {NULL, NULL, NULL},
+};
+
+static struct shell_command_set_t netcoding_command_set = {
+    .next = NULL,
+    .commands = netcoding_commands,
+};
+
+void netcoding_shell_init(void) {
+    shell_command_set_register(&netcoding_command_set);
+}
+
+#endif /* BUILD_WITH_SHELL */
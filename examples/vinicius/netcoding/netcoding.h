@@ -2,9 +2,10 @@
 #define NET_CODING_H_
 
 #include "buffer.h"
-#include "hash_table.h"
+#include "gf256.h"
 #include "node.h"
 #include "packet.h"
+#include "xor.h"
 
 /**
  * @brief The receivers are the NUM_RECEIVERS-th first nodes.
@@ -12,307 +13,1036 @@
  */
 #define NUM_RECEIVERS 1
 
+/**
+ * @brief Number of senders. Each one sends the packet ids congruent to its node
+ * ID modulo NUM_SENDERS, so every packet gets its own id and the packets the
+ * senders send at about the same time share a generation, where they can be
+ * combined. Defaults to the two senders of simulacoes/2-sender-1rcvr.csc.
+ *
+ */
+#ifndef NUM_SENDERS
+#define NUM_SENDERS 2
+#elif NUM_SENDERS < 1
+#error NUM_SENDERS must be at least 1
+#endif
+
+/**
+ * @brief Get the id of a packet of a sender, reference NUM_SENDERS.
+ *
+ * @param node_id The node ID of the sender.
+ * @param seq The number of packets the sender sent before this one.
+ * @return uint32_t
+ */
+static inline uint32_t get_sender_packet_id(uint16_t node_id, uint32_t seq) {
+    return node_id + seq * NUM_SENDERS;
+}
+
 /* ------------------- CODING ----------------------------------------------- */
+static void schedule_flush(netcoding_node* node);
+
+/**
+ * @brief Stores a packet inside a node for some time. If the packet is raw, it
+ * goes to the raw_buffer and combination_buffer otherwise, in the queue of its
+ * flow. Since the hold timer expects the buffers in deadline order, all the
+ * packets of a buffer must be held for the same delay.
+ *
+ * @param node
+ * @param packet
+ * @param body Its payload, copied into the buffer slot.
+ * @param route The route of the packet, or NULL if it is unknown.
+ * @param delay How long the packet is held, reference
+ * `flush_expired_packets`.
+ * @return int 1 if the packet was stored and 0 otherwise.
+ */
+static int hold_packet(netcoding_node* node,
+                       netcoding_packet* packet,
+                       const char* body,
+                       netcoding_route* route,
+                       clock_time_t delay) {
+    packet_buffer* buffer = is_raw_packet(packet) ? &node->raw_buffer
+                                                  : &node->combination_buffer;
+    netcoding_route flow_route;
+
+    if(route) {
+        flow_route = *route;
+        flow_route.flow = get_flow(node, route);
+        route = &flow_route;
+    }
+    if(node->raw_buffer.size + node->combination_buffer.size
+           >= NETCODING_MAX_OCCUPANCY
+       || !push_routed_packet(buffer, packet, body, route)) {
+        NETCODING_EVENT(&node->stats,
+                        NETCODING_EVENT_BUFFER_FULL,
+                        packet->header.holding_packets[0]);
+        return 0;
+    }
+
+    ((netcoding_slot*)buffer->tail)->deadline = clock_time() + delay;
+    schedule_flush(node);
+    return 1;
+}
+
 /**
- * @brief Stores a packet inside a node. If the packet is raw, it goes to the
- * raw_buffer and combination_buffer otherwise.
+ * @brief Stores a packet inside a node, withheld for up to
+ * NETCODING_MAX_HOLD_DELAY, reference `hold_packet`.
  *
  * @param node
  * @param packet
+ * @param route The route of the packet, or NULL if it is unknown.
  * @return int 1 if the packet was stored and 0 otherwise.
  */
-static int store_packet(netcoding_node* node, netcoding_packet* packet) {
-    if(is_raw_packet(packet)) return push_packet(&node->raw_buffer, packet);
-    return push_packet(&node->combination_buffer, packet);
+static inline int store_packet(netcoding_node* node,
+                               netcoding_packet* packet,
+                               netcoding_route* route) {
+    return hold_packet(
+        node, packet, packet->body, route, NETCODING_MAX_HOLD_DELAY);
 }
 
-static int should_combine_packet(netcoding_node* node) {
-    return rand() % 100 < node->prob_to_combine;
+static int should_combine_packet(netcoding_node* node,
+                                 netcoding_packet* packet,
+                                 netcoding_route* route) {
+    return node->policy && node->policy(node, packet, route);
+}
+
+/**
+ * @brief Get the flows a packet going to a destination may be combined with,
+ * i.e., the ones with the same destination, since the combination is decoded
+ * there, longest queue first.
+ *
+ * @param node
+ * @param destination
+ * @param flows Where the flows are written.
+ * @return int The number of flows.
+ */
+static int get_coding_flows(netcoding_node* node,
+                            netcoding_addr destination,
+                            uint8_t flows[NETCODING_FLOWS]) {
+    int sizes[NETCODING_FLOWS];
+    int num_flows = 0;
+
+    for(int i = 0; i < NETCODING_FLOWS; i++) {
+        int size = get_flow_size(node, i);
+        int j;
+
+        if(!size || node->flows[i].destination != destination) continue;
+        // Insertion sort, there are only a few flows
+        for(j = num_flows++; j > 0 && sizes[j - 1] < size; j--) {
+            sizes[j] = sizes[j - 1];
+            flows[j] = flows[j - 1];
+        }
+        sizes[j] = size;
+        flows[j] = i;
+    }
+    return num_flows;
+}
+
+/**
+ * @brief Get the slots of a buffer out of every flow whose packets may go to
+ * a destination, i.e., the ones withheld with no route or while no flow was
+ * free.
+ *
+ * @param buffer
+ * @param destination
+ * @param slots Where the bitmap of the slots is written.
+ */
+static void get_unclassified_slots(packet_buffer* buffer,
+                                   netcoding_addr destination,
+                                   uint32_t slots[NETCODING_BITMAP_WORDS]) {
+    memset(slots, 0, NETCODING_BITMAP_WORDS * sizeof(uint32_t));
+    for(linked_list_node* cur_node = buffer->head; cur_node;
+        cur_node = cur_node->next) {
+        netcoding_slot* slot = (netcoding_slot*)cur_node;
+        int slot_index = get_slot_index(buffer, slot);
+
+        if(slot->route.flow != NETCODING_FLOW_NONE
+           || (slot->route.destination != NETCODING_ADDR_NONE
+               && slot->route.destination != destination))
+            continue;
+        slots[slot_index / 32] |= 1u << (slot_index % 32);
+    }
 }
 
 /**
  * @brief Get the packet to combine. To do that it searches for a fitting packet
- * inside the combination_buffer. Reference `are_fitting_headers` to understand
- * more about fitting packets.
+ * inside the combination_buffer and then the raw_buffer. Reference
+ * `are_fitting_headers` to understand more about fitting packets, or
+ * `are_recodable_headers` on RLNC mode. When the route of the packet is known,
+ * only the flows going to its destination are searched, longest queue first,
+ * since the longest queue is the one holding its packets back the most.
+ *
+ * The packet is left in its slot, so it is combined from there, and then
+ * `remove_slot` is called on the buffer holding it.
  *
  * @param node The node holding the packet buffer.
  * @param inbound_packet The packet to be complementary matched in the buffer.
- * @param packet_to_combine A pointer to hold the packet to combine.
- * @return int
+ * @param route The route of the packet, or NULL if it is unknown.
+ * @param buffer A pointer to hold the buffer of the packet to combine.
+ * @return netcoding_slot* The slot of the packet to combine or NULL if there
+ * is none.
  */
-static int get_packet_to_combine(netcoding_node* node,
-                                 netcoding_packet* inbound_packet,
-                                 netcoding_packet* packet_to_combine) {
-    // There is only one packet slot remaining
-    if(get_header_num_packets(&inbound_packet->header)
-       == NUM_COMBINATIONS - 1) {
-        return pop_fitting_packet(
-            &node->raw_buffer, &inbound_packet->header, packet_to_combine);
-    }
-
+static netcoding_slot* get_packet_to_combine(netcoding_node* node,
+                                             netcoding_packet* inbound_packet,
+                                             netcoding_route* route,
+                                             packet_buffer** buffer) {
+    header_predicate is_fitting = node->mode == NETCODING_MODE_RLNC
+                                      ? are_recodable_headers
+                                      : are_fitting_headers;
     // This beign called before raw_buffer prioritizes combination_buffer. I
     // guess this will deliver more info in 1 packet, then the network will have
     // a bigger throughput gain with this
-    int found_combined_fitting = pop_fitting_packet(
-        &node->combination_buffer, &inbound_packet->header, packet_to_combine);
+    packet_buffer* buffers[] = {&node->combination_buffer, &node->raw_buffer};
+    // There is only one packet slot remaining. On RLNC a coded packet may still
+    // fit, since it can share packets with the inbound one
+    int first_buffer = node->mode == NETCODING_MODE_XOR
+                       && get_header_num_packets(&inbound_packet->header)
+                              == NUM_COMBINATIONS - 1;
+    uint8_t flows[NETCODING_FLOWS];
+    int num_flows;
+    netcoding_slot* slot;
 
-    if(!found_combined_fitting) {
-        return pop_fitting_packet(
-            &node->raw_buffer, &inbound_packet->header, packet_to_combine);
+    if(!route) {
+        for(int b = first_buffer; b < 2; b++) {
+            slot = find_fitting_packet(
+                buffers[b], &inbound_packet->header, is_fitting, NULL);
+            if(slot) {
+                *buffer = buffers[b];
+                return slot;
+            }
+        }
+        return NULL;
     }
-    return found_combined_fitting;
+
+    // The unclassified slots are searched after every flow
+    num_flows = get_coding_flows(node, route->destination, flows);
+    for(int f = 0; f <= num_flows; f++) {
+        for(int b = first_buffer; b < 2; b++) {
+            uint32_t slots[NETCODING_BITMAP_WORDS];
+
+            if(f < num_flows)
+                memcpy(slots, get_flow_slots(buffers[b], flows[f]), sizeof(slots));
+            else
+                get_unclassified_slots(buffers[b], route->destination, slots);
+            slot = find_fitting_packet(
+                buffers[b], &inbound_packet->header, is_fitting, slots);
+            if(slot) {
+                *buffer = buffers[b];
+                return slot;
+            }
+        }
+    }
+    return NULL;
 }
 
+/**
+ * @brief XORs two packet payloads. The combined payload may be any of the
+ * inputs, so a payload can be combined in place (e.g. inside the uip buffer).
+ *
+ * @param data1
+ * @param data2
+ * @param combined
+ */
 static void xor_combine(char data1[PAYLOAD_SIZE],
                         char data2[PAYLOAD_SIZE],
                         char combined[PAYLOAD_SIZE]) {
-    for(int i = 0; i < PAYLOAD_SIZE; i++) combined[i] = data1[i] ^ data2[i];
+    xor_bytes((uint8_t*)combined,
+              (const uint8_t*)data1,
+              (const uint8_t*)data2,
+              PAYLOAD_SIZE);
 }
 
 /**
- * @brief Combine two packets
+ * @brief Combine two packets. The combined packet may be one of the inputs.
  *
  * @param pck1 Packet of reference.
  * @param pck2 Packet to be merged.
- * @return netcoding_packet* The new combined packet.
+ * @param combined_packet Where the combined packet is written.
  */
-static netcoding_packet* combine_packets(netcoding_packet* pck1,
-                                         netcoding_packet* pck2) {
-    netcoding_packet* combined_packet =
-        (netcoding_packet*)malloc(sizeof(netcoding_packet));
-
+static inline void combine_packets(netcoding_packet* pck1,
+                                   netcoding_packet* pck2,
+                                   netcoding_packet* combined_packet) {
     combined_packet->header = xor_merge_headers(&pck1->header, &pck2->header);
     xor_combine(pck1->body, pck2->body, combined_packet->body);
+}
+
+/**
+ * @brief Recode a packet under RLNC in place, as `packet + c * pck2` with a
+ * random non zero coefficient `c`. Neither packet needs to be decoded, both may
+ * already be combinations.
+ *
+ * @param node The node drawing the coefficient.
+ * @param packet Packet of reference, whose header is recoded.
+ * @param body Its payload, recoded in place.
+ * @param pck2 Packet to be merged.
+ */
+static void recode_packets(netcoding_node* node,
+                           netcoding_packet* packet,
+                           char* body,
+                           netcoding_packet* pck2) {
+    uint8_t coefficient = 1 + netcoding_random(node) % 255;
+
+    packet->header =
+        linear_merge_headers(&packet->header, 1, &pck2->header, coefficient);
+    gf256_mul_add((uint8_t*)body,
+                  (const uint8_t*)pck2->body,
+                  coefficient,
+                  PAYLOAD_SIZE);
+}
+
+/**
+ * @brief Combines a packet with a fitting stored one, if there is any,
+ * recoding them on RLNC mode. The stored payload is combined straight out of
+ * its slot into the payload of the packet, wherever it lies.
+ *
+ * @param node
+ * @param packet The packet, whose header is combined in place.
+ * @param body Its payload, combined in place.
+ * @param route Its route, or NULL if it is unknown.
+ * @return int 1 if the packet was combined and 0 otherwise.
+ */
+static int combine_with_stored_packet(netcoding_node* node,
+                                      netcoding_packet* packet,
+                                      char* body,
+                                      netcoding_route* route) {
+    packet_buffer* buffer;
+    netcoding_slot* slot = get_packet_to_combine(node, packet, route, &buffer);
+
+    if(!slot) return 0;
+    if(node->mode == NETCODING_MODE_RLNC) {
+        recode_packets(node, packet, body, &slot->packet);
+    }
+    else {
+        packet->header =
+            xor_merge_headers(&packet->header, &slot->packet.header);
+        xor_combine(body, slot->packet.body, body);
+    }
+    remove_slot(buffer, slot);
+    return 1;
+}
+
+#if NETCODING_COPE
+/**
+ * @brief Verifies if a stored native packet can join a COPE combination: it
+ * must go through a next hop not used yet, which holds every packet already
+ * combined, whose next hops hold it as well. The packets must go to the same
+ * destination, since the coded packet is routed towards it, unless every
+ * next hop is the destination of its packet (crossing flows, e.g. the X and
+ * butterfly topologies), which then delivers it.
+ *
+ * @param cope
+ * @param slot The stored packet.
+ * @param ids The packets already combined.
+ * @param routes Their routes.
+ * @param num_packets
+ * @return int
+ */
+static int is_cope_decodable(netcoding_cope* cope,
+                             netcoding_slot* slot,
+                             uint32_t ids[NUM_COMBINATIONS],
+                             netcoding_route routes[NUM_COMBINATIONS],
+                             int num_packets) {
+    uint32_t packet_id = slot->packet.header.holding_packets[0];
+
+    if(slot->route.destination != routes[0].destination) {
+        if(slot->route.next_hop != slot->route.destination) return 0;
+        for(int i = 0; i < num_packets; i++) {
+            if(routes[i].next_hop != routes[i].destination) return 0;
+        }
+    }
+    for(int i = 0; i < num_packets; i++) {
+        if(slot->route.next_hop == routes[i].next_hop) return 0;
+        if(!is_holding(cope, routes[i].next_hop, packet_id)) return 0;
+        if(!is_holding(cope, slot->route.next_hop, ids[i])) return 0;
+    }
+    return 1;
+}
+
+/**
+ * @brief Combines a native packet with the stored ones that every next hop can
+ * decode, filling the recipients of the coded packet. Each packet is taken
+ * from the flow with the longest queue among the decodable ones, the oldest of
+ * it first, so the busiest flows are drained first.
+ *
+ * @param node
+ * @param packet The native packet, combined in place.
+ * @param route Its route.
+ * @return int The number of packets combined into it.
+ */
+static int combine_cope_packets(netcoding_node* node,
+                                netcoding_packet* packet,
+                                netcoding_route* route) {
+    netcoding_cope* cope = &node->cope;
+    uint32_t ids[NUM_COMBINATIONS] = {packet->header.holding_packets[0]};
+    netcoding_route routes[NUM_COMBINATIONS] = {*route};
+    int num_packets = 1;
+
+    packet->cope.crossing = 0;
+    while(num_packets < NUM_COMBINATIONS) {
+        netcoding_slot* best = NULL;
+        int best_size = -1;
+
+        // The buffer is in deadline order, so the first slot of a flow is its
+        // oldest one
+        for(linked_list_node* cur_node = node->raw_buffer.head; cur_node;
+            cur_node = cur_node->next) {
+            netcoding_slot* slot = (netcoding_slot*)cur_node;
+            int size = 0;
+
+            if(!are_fitting_headers(&packet->header, &slot->packet.header)
+               || !is_cope_decodable(cope, slot, ids, routes, num_packets))
+                continue;
+            if(slot->route.flow != NETCODING_FLOW_NONE)
+                size = count_slots(
+                    get_flow_slots(&node->raw_buffer, slot->route.flow));
+            if(size > best_size) {
+                best = slot;
+                best_size = size;
+            }
+        }
+        if(!best) break;
+
+        ids[num_packets] = best->packet.header.holding_packets[0];
+        routes[num_packets++] = best->route;
+        if(best->route.destination != routes[0].destination)
+            packet->cope.crossing = 1;
+        combine_packets(packet, &best->packet, packet);
+        remove_slot(&node->raw_buffer, best);
+    }
+
+    for(int i = 0; i < NUM_COMBINATIONS; i++) {
+        packet->cope.recipients[i] =
+            i < num_packets && num_packets > 1 ? routes[i].next_hop
+                                               : NETCODING_ADDR_NONE;
+    }
+    return num_packets - 1;
+}
+
+/**
+ * @brief Routes a packet on the COPE mode. A native packet is combined with
+ * every stored one its next hops can decode. If there is none, it is stored
+ * only while another neighbor holds it, since a packet going to that neighbor
+ * may be combined with it later. Coded packets are forwarded as they are.
+ *
+ * @param node
+ * @param packet The packet to be routed, combined in place.
+ * @param route Its route.
+ * @return int 1 if the packet should be routed and 0 if it was withheld.
+ */
+static int encode_cope_packet(netcoding_node* node,
+                              netcoding_packet* packet,
+                              netcoding_route* route) {
+    netcoding_cope* cope = &node->cope;
+
+    if(is_raw_packet(packet)) {
+        uint32_t packet_id = packet->header.holding_packets[0];
+
+        hold_native(cope, packet);
+        if(combine_cope_packets(node, packet, route)) {
+            NETCODING_EVENT(&node->stats, NETCODING_EVENT_CODED, packet_id);
+        }
+        else if(count_holders(cope, packet_id, route->next_hop)
+                && store_packet(node, packet, route)) {
+            NETCODING_EVENT(&node->stats, NETCODING_EVENT_STORED, packet_id);
+            return 0;
+        }
+    }
+
+    // Assumes the transmission succeeds, as the link layer retransmits it
+    learn_from_packet(cope, NETCODING_ADDR_NONE, route->next_hop, packet);
+    fill_reception_reports(cope, packet);
+    return 1;
+}
+
+/**
+ * @brief Decodes in place a COPE coded packet this node is a recipient of, by
+ * XORing out the native packets it holds. It is left untouched if this node
+ * is not a recipient or misses more than one of its packets.
+ *
+ * @param node
+ * @param self The address of this node.
+ * @param packet
+ * @return int The number of packets remaining in the packet: 1 if it is now
+ * the native one this node should forward, and 0 if it held all of them.
+ */
+static inline int decode_cope_packet(netcoding_node* node,
+                                     netcoding_addr self,
+                                     netcoding_packet* packet) {
+    netcoding_packet reduced = *packet;
+    int num_packets = get_header_num_packets(&packet->header);
 
-    return combined_packet;
+    if(!is_cope_recipient(packet, self) || num_packets < 2) return num_packets;
+
+    num_packets = reduce_with_held_natives(&node->cope, &reduced);
+    if(num_packets > 1) return num_packets;
+
+    *packet = reduced;
+    memset(packet->cope.recipients,
+           NETCODING_ADDR_NONE,
+           sizeof(packet->cope.recipients));
+    packet->cope.crossing = 0;
+    if(num_packets) hold_native(&node->cope, packet);
+    return num_packets;
+}
+#endif
+
+/**
+ * @brief Routes a packet on the systematic coding: it is always routed as it
+ * is. Native packets are also kept for up to NETCODING_MAX_HOLD_DELAY, and
+ * every 100 / `redundancy` of them a repair packet is combined out of the
+ * packet and a kept one, sent once the packet is gone. Repair packets sit
+ * alone in the combination_buffer, so it stays in deadline order.
+ *
+ * @param node
+ * @param packet The packet to be routed.
+ * @param body Its payload, left untouched.
+ * @param route Its route, or NULL if it is unknown.
+ * @return int 1, since the packet should always be routed.
+ */
+static int encode_systematic_packet(netcoding_node* node,
+                                    netcoding_packet* packet,
+                                    char* body,
+                                    netcoding_route* route) {
+    netcoding_packet repair;
+
+    // Coded packets already are repair packets
+    if(!is_raw_packet(packet)) return 1;
+
+    node->repair_credit += node->redundancy;
+    if(node->repair_credit >= 100) {
+        repair.header = packet->header;
+#if NETCODING_COPE
+        repair.cope = packet->cope;
+#endif
+        memcpy(repair.body, body, PAYLOAD_SIZE);
+        if(combine_with_stored_packet(node, &repair, repair.body, route)
+           && hold_packet(node, &repair, repair.body, route, 0)) {
+            NETCODING_EVENT(&node->stats,
+                            NETCODING_EVENT_REPAIR,
+                            repair.header.holding_packets[0]);
+            node->repair_credit -= 100;
+        }
+    }
+    // The owed repairs are not accumulated while nothing can be combined
+    if(node->repair_credit > 100) node->repair_credit = 100;
+
+    hold_packet(node, packet, body, route, NETCODING_MAX_HOLD_DELAY);
+    return 1;
 }
 
 /**
  * @brief Function that routes a packet according to network coding rules:
- * 1) With a probability P, the packet should be combined. With 1-P the packet
- * should be sent with no modifications.
- * 2) If P happens, the node will try to combine the received packet with any
+ * 1) If the combination policy of the node decides so (with a probability P by
+ * default), the packet should be combined. Otherwise the packet should be sent
+ * with no modifications.
+ * 2) If it does, the node will try to combine the received packet with any
  * previous stored packet. If there is no valid packet to combine, then store
  * the packet.
+ * On the COPE mode the decision depends on what the next hops hold instead,
+ * reference `encode_cope_packet`, and on the systematic coding packets are
+ * never withheld, reference `encode_systematic_packet`.
+ *
+ * The packet is a view: its header is parsed into `packet`, whose body is not
+ * used, and its payload is wherever `body` points to, e.g. inside the uip
+ * buffer of the datagram being forwarded. A combination is then XORed right
+ * into it, so routing a packet costs a single pass over its payload. The COPE
+ * mode keeps whole packets, so there `body` must be the packet body.
  *
  * @param node The node to route the packet.
- * @param packet The packet to be routed.
- * @return netcoding_packet
+ * @param packet The header of the packet to be routed. If it gets combined,
+ * the combined header is written over it.
+ * @param body The payload of the packet, combined in place.
+ * @param route The route of the packet, or NULL if it is unknown.
+ * @return int 1 if the packet should be routed and 0 if it was withheld, or
+ * dropped since it is coded and its receiver acknowledged its generation.
  */
-static netcoding_packet* encode_packet(netcoding_node* node,
-                                       netcoding_packet* packet) {
+static int encode_packet_view(netcoding_node* node,
+                              netcoding_packet* packet,
+                              char* body,
+                              netcoding_route* route) {
+    uint32_t packet_id = packet->header.holding_packets[0];
+
+    // Native packets are always routed, they are worth delivering on their own
+    if(!is_raw_packet(packet) && route
+       && is_generation_acked(node,
+                              route->destination,
+                              get_header_generation(&packet->header))) {
+        NETCODING_EVENT(&node->stats, NETCODING_EVENT_DROPPED, packet_id);
+        return 0;
+    }
+
+#if NETCODING_COPE
+    if(node->mode == NETCODING_MODE_COPE && route)
+        return encode_cope_packet(node, packet, route);
+#endif
+    if(node->systematic)
+        return encode_systematic_packet(node, packet, body, route);
     if(  // TODO: packet->header.can_be_combined ||
-        should_combine_packet(node)) {
-        netcoding_packet packet_to_combine;
-        if(get_packet_to_combine(node, packet, &packet_to_combine)) {
-            printf("Combinou\n");
-            return combine_packets(packet, &packet_to_combine);
+        should_combine_packet(node, packet, route)) {
+        if(combine_with_stored_packet(node, packet, body, route)) {
+            NETCODING_EVENT(&node->stats, NETCODING_EVENT_CODED, packet_id);
+            return 1;
         }
 
-        if(store_packet(node, packet)) {
-            printf("Armazenou\n");
+        // When it can not be stored, it is routed as it is
+        if(hold_packet(node, packet, body, route, NETCODING_MAX_HOLD_DELAY)) {
+            NETCODING_EVENT(&node->stats, NETCODING_EVENT_STORED, packet_id);
+            return 0;
         }
-        return NULL;
     }
-    return packet;
+    return 1;
 }
 
-/* ------------------- DECODING --------------------------------------------- */
 /**
- * @brief Function that copies the item into the hashmap slot
+ * @brief Routes a packet according to network coding rules, reference
+ * `encode_packet_view`.
  *
- * @param item
- * @param dest
+ * @param node The node to route the packet.
+ * @param packet The packet to be routed. If it gets combined, the combination
+ * is written over it.
+ * @param route The route of the packet, or NULL if it is unknown.
+ * @return int 1 if the packet should be routed and 0 if it was withheld, or
+ * dropped since it is coded and its receiver acknowledged its generation.
  */
-static void deep_copy(void* item, void** dest) {
-    //! Assumes the item will be freed
-    netcoding_packet** packet_dest = (netcoding_packet**)dest;
-    netcoding_packet* packet =
-        (netcoding_packet*)malloc(sizeof(netcoding_packet));
-    memcpy(packet, item, sizeof(netcoding_packet));
-    *packet_dest = packet;
+static int encode_packet(netcoding_node* node,
+                         netcoding_packet* packet,
+                         netcoding_route* route) {
+    return encode_packet_view(node, packet, packet->body, route);
+}
 
-    //! Assumes item will be mantained allocated
-    //     netcoding_packet** packet_dest = (netcoding_packet**)dest;
-    //     *packet_dest = item;
+/* ------------------- HOLD TIMER ------------------------------------------- */
+/**
+ * @brief Sends a withheld packet, after combining it with a stored one if
+ * there is any it fits (ignoring the combination probability). On the
+ * systematic coding native packets were already routed, so they are only
+ * dropped.
+ *
+ * @param node
+ * @param buffer The buffer holding the packet.
+ * @param slot The slot of the packet.
+ */
+static void flush_packet(netcoding_node* node,
+                         packet_buffer* buffer,
+                         netcoding_slot* slot) {
+    netcoding_packet packet;
+    netcoding_route route = slot->route;
+    uint32_t packet_id = slot->packet.header.holding_packets[0];
+    int combined;
+
+    // Already routed, it is dropped without being copied out of its slot
+    if(node->systematic && is_raw_packet(&slot->packet)) {
+        remove_slot(buffer, slot);
+        return;
+    }
+    packet = slot->packet;
+    remove_slot(buffer, slot);
+#if NETCODING_COPE
+    if(node->mode == NETCODING_MODE_COPE) {
+        combined = combine_cope_packets(node, &packet, &route);
+        learn_from_packet(
+            &node->cope, NETCODING_ADDR_NONE, route.next_hop, &packet);
+        fill_reception_reports(&node->cope, &packet);
+    }
+    else
+#endif
+        combined = combine_with_stored_packet(
+            node,
+            &packet,
+            packet.body,
+            route.next_hop != NETCODING_ADDR_NONE ? &route : NULL);
+
+    if(combined)
+        NETCODING_EVENT(&node->stats, NETCODING_EVENT_CODED, packet_id);
+    NETCODING_EVENT(&node->stats, NETCODING_EVENT_FLUSHED, packet_id);
+    if(node->transmit) node->transmit(&packet, &route);
 }
 
 /**
- * @brief The an facade to the hash calculator for a netcoding packet
+ * @brief The hold timer callback. It flushes every packet whose deadline
+ * expired, which are at the head of the buffers, since packets are appended
+ * in deadline order.
  *
- * @param data
- * @return size_t
+ * @param ptr The node.
  */
-static size_t facade_hash_calculator(void* data) {
-    return packet_hash((netcoding_packet*)data);
+static void flush_expired_packets(void* ptr) {
+    netcoding_node* node = (netcoding_node*)ptr;
+    packet_buffer* buffers[] = {&node->combination_buffer, &node->raw_buffer};
+    clock_time_t now = clock_time();
+
+    for(int i = 0; i < 2; i++) {
+        while(buffers[i]->head
+              && !CLOCK_LT(now, ((netcoding_slot*)buffers[i]->head)->deadline))
+            flush_packet(node, buffers[i], (netcoding_slot*)buffers[i]->head);
+    }
+    schedule_flush(node);
 }
 
 /**
- * @brief Creates a new netcoding packet pointer array (where the content of the
- * hash table resides).
+ * @brief Sets the hold timer to the deadline of the oldest withheld packet, or
+ * stops it if there is none.
  *
- * @param size
- * @return void**
+ * @param node
  */
-static void** array_allocator(int size) {
-    return (void**)malloc(size * sizeof(netcoding_packet**));
+static void schedule_flush(netcoding_node* node) {
+    linked_list_node* heads[] = {node->combination_buffer.head,
+                                 node->raw_buffer.head};
+    netcoding_slot* oldest = NULL;
+    clock_time_t now = clock_time();
+
+    for(int i = 0; i < 2; i++) {
+        netcoding_slot* slot = (netcoding_slot*)heads[i];
+        if(slot && (!oldest || CLOCK_LT(slot->deadline, oldest->deadline)))
+            oldest = slot;
+    }
+
+    if(!oldest) {
+        ctimer_stop(&node->hold_timer);
+        return;
+    }
+    ctimer_set(&node->hold_timer,
+               CLOCK_LT(now, oldest->deadline) ? oldest->deadline - now : 0,
+               flush_expired_packets,
+               node);
 }
 
+/* ------------------- SLIDING WINDOW --------------------------------------- */
 /**
- * @brief Detects collision on the hash map. Considers only the headers in order
- * to detect collision.
+ * @brief Evicts the withheld packets going to a receiver of the generations
+ * in `[from, to)`.
  *
- * @param data1
- * @param data2
- * @return int
+ * @param node
+ * @param receiver
+ * @param from
+ * @param to
  */
-static int is_header_collision(void* data1, void* data2) {
-    netcoding_packet* h1 = (netcoding_packet*)data1;
-    netcoding_packet* h2 = (netcoding_packet*)data2;
-    return are_equivalent_headers(&h1->header, &h2->header);
+static void evict_acked_generations(netcoding_node* node,
+                                    netcoding_addr receiver,
+                                    uint32_t from,
+                                    uint32_t to) {
+    evict_generations(&node->combination_buffer, from, to, receiver);
+    evict_generations(&node->raw_buffer, from, to, receiver);
 }
 
 /**
- * @brief Inserts  all packets in the node's buffers into the hash map.
+ * @brief Slides the coding window of a receiver on its acknowledgment,
+ * evicting the withheld packets going to it of the generations it fully
+ * decoded. A receiver not seen before takes a free window.
  *
- * @param map
  * @param node
+ * @param receiver The receiver that sent the acknowledgment.
+ * @param base The lowest generation it did not fully decode.
+ * @param decoded_ahead The generations it fully decoded past `base`, bit `i`
+ * standing for generation `base + i`.
+ * @return int 1 if the window moved and 0 if the acknowledgment is not new,
+ * or there is no window left for the receiver.
  */
-static void fill_with_existing_packets(hash_table* map, netcoding_node* node) {
-    linked_list_node* cur_node = node->raw_buffer.head;
+static inline int acknowledge_generations(netcoding_node* node,
+                                          netcoding_addr receiver,
+                                          uint32_t base,
+                                          uint32_t decoded_ahead) {
+    netcoding_window* window;
 
-    while(cur_node) {
-        try_insert_item(map, cur_node->data);
-        cur_node = cur_node->next;
-    }
+    if(receiver == NETCODING_ADDR_NONE) return 0;
+    if(!(window = get_receiver_window(node, receiver)))
+        window = get_receiver_window(node, NETCODING_ADDR_NONE);
+    if(!window || base < window->base) return 0;
+    window->receiver = receiver;
+
+    // The generations the window already knows as decoded, seen from `base`
+    uint32_t shift = base - window->base;
+    uint32_t known = shift < 32 ? window->decoded_ahead >> shift : 0;
+    uint32_t fresh = decoded_ahead & ~known;
+    if(!shift && !fresh) return 0;
 
-    cur_node = node->combination_buffer.head;
-    while(cur_node) {
-        try_insert_item(map, cur_node->data);
-        cur_node = cur_node->next;
+    evict_acked_generations(node, receiver, window->base, base);
+    for(uint32_t bits = fresh; bits; bits &= bits - 1) {
+        uint32_t generation = base + __builtin_ctz(bits);
+        evict_acked_generations(node, receiver, generation, generation + 1);
     }
+    window->base = base;
+    window->decoded_ahead = decoded_ahead | known;
+    schedule_flush(node);
+    return 1;
 }
 
+/* ------------------- DECODING --------------------------------------------- */
 /**
- * @brief Function that realy decodes two packets using XOR logic.
+ * @brief Get the decoding state of a generation. If the generation is not being
+ * decoded yet, the free (or else the least recently updated) slot is reset to
+ * hold it. Discarding a generation only drops its rows: it is not acknowledged,
+ * and its packets still to come start decoding it over.
  *
- * @param pck1
- * @param pck2
- * @return netcoding_packet*
+ * @param node
+ * @param generation
+ * @return netcoding_generation*
  */
-static netcoding_packet* resolve_packets(netcoding_packet* pck1,
-                                         netcoding_packet* pck2) {
-    netcoding_packet* combined_packet =
-        (netcoding_packet*)malloc(sizeof(netcoding_packet));
+static netcoding_generation* get_decoding_generation(netcoding_node* node,
+                                                     uint32_t generation) {
+    netcoding_decoder* decoder = &node->decoder;
+    netcoding_generation* oldest = &decoder->generations[0];
 
-    combined_packet->header = xor_merge_headers(&pck1->header, &pck2->header);
-    xor_combine(pck1->body, pck2->body, combined_packet->body);
+    for(int i = 0; i < NETCODING_DECODE_GENERATIONS; i++) {
+        netcoding_generation* cur = &decoder->generations[i];
+
+        if(cur->rank && cur->generation == generation) return cur;
+        if(!oldest->rank) continue;
+        if(!cur->rank || cur->last_update < oldest->last_update) oldest = cur;
+    }
+
+    if(oldest->rank)
+        remove_generation_headers(&decoder->seen, oldest->generation);
+    if(oldest->rank && oldest->rank < NETCODING_GENERATION_SIZE) {
+        NETCODING_EVENT(&node->stats,
+                        NETCODING_EVENT_DECODE_FAILURE,
+                        oldest->generation * NETCODING_GENERATION_SIZE);
+    }
+    memset(oldest, 0, sizeof(netcoding_generation));
+    oldest->generation = generation;
+    return oldest;
+}
 
-    return combined_packet;
+/**
+ * @brief Verifies if a row holds a single packet, i.e., its only non zero
+ * coefficient is the pivot.
+ *
+ * @param state
+ * @param row
+ * @return int
+ */
+static int is_decoded_row(netcoding_generation* state, int row) {
+    for(int i = 0; i < NETCODING_GENERATION_SIZE; i++) {
+        if(i != row && state->coefficients[row][i]) return 0;
+    }
+    return 1;
 }
 
 /**
- * @brief Given an hash map and a packet to be decoded, iterates over the hash
- * map elements and try to generate not seen packets to be added to the output
- * list if it's of size 1 (has only one packet information) and insert it to the
- * packets_to_decode doesn't matter the size.
+ * @brief Delivers the packet of a row if it is decoded and was not delivered
+ * yet.
  *
- * @param map
- * @param packet_to_decode
- * @param packets_to_decode
+ * @param state
+ * @param row
  * @param output_list
  */
-static void decode_packet_over_map(hash_table* map,
-                                   netcoding_packet* packet_to_decode,
-                                   struct linked_list_t* packets_to_decode,
-                                   struct linked_list_t* output_list) {
-    // Iterate for each already obtained packet in the hashmap
-    for(int i = 0; i < map->capacity; i++) {
-        if(map->keys[i]) {
-            netcoding_packet* mapped_packet = (netcoding_packet*)map->items[i];
-
-            netcoding_packet* resolved_packet =
-                resolve_packets(packet_to_decode, mapped_packet);
-
-            int header_size = get_header_num_packets(&resolved_packet->header);
-
-            if(!header_size) continue;
-
-            int did_insert = try_insert_item(map, resolved_packet);
-            // This packet was not created yet
-            if(did_insert == 1) {
-                push_packet(packets_to_decode, resolved_packet);
-                // If is a raw packet never found
-                if(header_size == 1) {
-                    push_packet(output_list, resolved_packet);
-                }
-            }
-            else {
-                free(resolved_packet);
+static void deliver_decoded_row(netcoding_generation* state,
+                                int row,
+                                struct linked_list_t* output_list) {
+    if(state->decoded[row] || !is_decoded_row(state, row)) return;
+
+    netcoding_packet packet = create_packet(
+        state->generation * NETCODING_GENERATION_SIZE + row, "");
+    memcpy(packet.body, state->payloads[row], PAYLOAD_SIZE);
+
+    if(push_packet(output_list, &packet)) state->decoded[row] = 1;
+}
+
+/**
+ * @brief Inserts a packet into the matrix of its generation. The matrix is kept
+ * in reduced row echelon form, so the packet is first reduced by the existing
+ * rows, costing O(rank * payload), and then, if it brings new information, it
+ * becomes the row of its pivot column and is eliminated from the other rows.
+ *
+ * @param state The generation of the packet.
+ * @param packet
+ * @param body Its payload.
+ * @param output_list The list where newly decoded packets are pushed.
+ */
+static void insert_generation_row(netcoding_generation* state,
+                                  netcoding_packet* packet,
+                                  const char* body,
+                                  struct linked_list_t* output_list) {
+    netcoding_packet_header* header = &packet->header;
+    uint8_t coefficients[NETCODING_GENERATION_SIZE];
+    uint8_t payload[PAYLOAD_SIZE];
+
+    memset(coefficients, 0, NETCODING_GENERATION_SIZE);
+    for(int i = 0; i < get_header_num_packets(header); i++) {
+        coefficients[header->holding_packets[i] % NETCODING_GENERATION_SIZE] =
+            header->coefficients[i];
+    }
+    memcpy(payload, body, PAYLOAD_SIZE);
+
+    // Subtraction is also a XOR on GF(2^8). Since the rows are reduced, each
+    // subtraction leaves the other pivot columns untouched
+    int pivot = -1;
+    for(int column = 0; column < NETCODING_GENERATION_SIZE; column++) {
+        uint8_t factor = coefficients[column];
+        if(!factor) continue;
+
+        if(!state->has_pivot[column]) {
+            if(pivot < 0) pivot = column;
+            continue;
+        }
+        gf256_mul_add(coefficients,
+                      state->coefficients[column],
+                      factor,
+                      NETCODING_GENERATION_SIZE);
+        gf256_mul_add(payload, state->payloads[column], factor, PAYLOAD_SIZE);
+    }
+    // Linearly dependent on what was already received
+    if(pivot < 0) return;
+
+    uint8_t inverse = gf256_inv(coefficients[pivot]);
+    gf256_scale(coefficients, inverse, NETCODING_GENERATION_SIZE);
+    gf256_scale(payload, inverse, PAYLOAD_SIZE);
+
+    memcpy(state->coefficients[pivot], coefficients, NETCODING_GENERATION_SIZE);
+    memcpy(state->payloads[pivot], payload, PAYLOAD_SIZE);
+    state->has_pivot[pivot] = 1;
+    state->rank++;
+
+    for(int row = 0; row < NETCODING_GENERATION_SIZE; row++) {
+        if(!state->has_pivot[row]) continue;
+
+        uint8_t factor = state->coefficients[row][pivot];
+        if(row != pivot && factor) {
+            gf256_mul_add(state->coefficients[row],
+                          coefficients,
+                          factor,
+                          NETCODING_GENERATION_SIZE);
+            gf256_mul_add(
+                state->payloads[row], payload, factor, PAYLOAD_SIZE);
+        }
+        deliver_decoded_row(state, row, output_list);
+    }
+}
+
+/**
+ * @brief Verifies if the decoder knows a generation as fully decoded.
+ *
+ * @param decoder
+ * @param generation
+ * @return int
+ */
+static int is_decoded_generation(netcoding_decoder* decoder,
+                                 uint32_t generation) {
+    uint32_t offset = generation - decoder->acked_generation;
+
+    if(generation < decoder->acked_generation) return 1;
+    return offset < 32 && (decoder->decoded_ahead >> offset) & 1;
+}
+
+/**
+ * @brief Records a fully decoded generation and moves the cumulative
+ * acknowledgment past the fully decoded ones. A generation too far ahead to
+ * be flagged moves it forward too, e.g. when the first generation received is
+ * not 0: it jumps to the oldest generation of the last 32 still being decoded,
+ * or to the decoded one, and the generations it skips are given up on.
+ *
+ * @param decoder
+ * @param generation A generation not older than the acknowledged one.
+ */
+static void acknowledge_decoded_generation(netcoding_decoder* decoder,
+                                           uint32_t generation) {
+    int advanced = 1;
+
+    if(generation - decoder->acked_generation >= 32) {
+        uint32_t base = generation;
+
+        for(int i = 0; i < NETCODING_DECODE_GENERATIONS; i++) {
+            netcoding_generation* cur = &decoder->generations[i];
+
+            if(cur->rank && cur->rank < NETCODING_GENERATION_SIZE
+               && cur->generation < base && generation - cur->generation < 32)
+                base = cur->generation;
+        }
+        uint32_t shift = base - decoder->acked_generation;
+        decoder->decoded_ahead =
+            shift < 32 ? decoder->decoded_ahead >> shift : 0;
+        decoder->acked_generation = base;
+    }
+    decoder->decoded_ahead |= 1u << (generation - decoder->acked_generation);
+    while(advanced) {
+        advanced = 0;
+        while(decoder->decoded_ahead & 1) {
+            decoder->decoded_ahead >>= 1;
+            decoder->acked_generation++;
+        }
+        // Decoded too far ahead to be flagged, but still in its slot
+        for(int i = 0; i < NETCODING_DECODE_GENERATIONS && !advanced; i++) {
+            netcoding_generation* cur = &decoder->generations[i];
+
+            if(cur->rank == NETCODING_GENERATION_SIZE
+               && cur->generation == decoder->acked_generation) {
+                decoder->decoded_ahead |= 1;
+                advanced = 1;
             }
         }
     }
 }
 
 /**
- * @brief Given an node and the packet, returns a list with all the decoded
- * packets generated by this decodification.
+ * @brief Given an node and the packet, returns a list with all the packets
+ * decoded thanks to it. Each generation is decoded incrementally, so a packet
+ * is delivered as soon as the received packets allow solving it. The list
+ * belongs to the node decoder and stays valid until the next call, so the
+ * caller may `clear_list` it once done to give its slots back earlier. Packets
+ * of generations already fully decoded and packets already received are
+ * ignored.
+ *
+ * The packet is a view, reference `encode_packet_view`: its payload is read
+ * where it lies, e.g. in the received datagram, and only copied into the
+ * generation matrix when it brings new information.
  *
  * @param node
- * @param packet
+ * @param packet The header of the packet, whose body is not used.
+ * @param body The payload of the packet.
  * @return struct linked_list_t*
  */
-static struct linked_list_t* decode_packets(netcoding_node* node,
-                                            netcoding_packet* packet) {
-    struct linked_list_t *decoded_packets = (struct linked_list_t*)malloc(
-                             sizeof(struct linked_list_t)),
-                         *packets_to_decode = (struct linked_list_t*)malloc(
-                             sizeof(struct linked_list_t)),
-                         *next_packets_to_decode =
-                             (struct linked_list_t*)malloc(
-                                 sizeof(struct linked_list_t));
-    start_list(decoded_packets);
-    start_list(packets_to_decode);
-    start_list(next_packets_to_decode);
-
-    store_packet(node, packet);
-    push_packet(decoded_packets, packet);
-    // List with the next batch of packets to be decoded
-    push_packet(packets_to_decode, packet);
-
-    // Creates aa hashtable holding all the current packets in the node
-    hash_table already_processed_packets =
-        create_hash_table(NETCODING_WINDOW_SIZE * 3,
-                          is_header_collision,
-                          array_allocator,
-                          facade_hash_calculator,
-                          deep_copy);
-    fill_with_existing_packets(&already_processed_packets, node);
-
-    while(packets_to_decode->size) {
-        linked_list_node* cur_node = packets_to_decode->head;
-        while(cur_node) {
-            netcoding_packet* cur_packet = (netcoding_packet*)cur_node->data;
-
-            decode_packet_over_map(&already_processed_packets,
-                                   cur_packet,
-                                   next_packets_to_decode,
-                                   decoded_packets);
-
-            cur_node = cur_node->next;
-        }
+static struct linked_list_t* decode_packets_view(netcoding_node* node,
+                                                 netcoding_packet* packet,
+                                                 const char* body) {
+    netcoding_decoder* decoder = &node->decoder;
+    struct linked_list_t* decoded_packets = &decoder->decoded_packets;
+    clear_list(decoded_packets);
 
-        // Set the next layer of packets as the current one
-        clear_list(packets_to_decode);
-        transfer_list(next_packets_to_decode, packets_to_decode);
-        start_list(next_packets_to_decode);
+#if NETCODING_COPE
+    // Packets this node overheard may already solve part of a coded one
+    netcoding_packet reduced;
+    if(node->mode == NETCODING_MODE_COPE) {
+        reduced.header = packet->header;
+        reduced.cope = packet->cope;
+        memcpy(reduced.body, body, PAYLOAD_SIZE);
+        reduce_with_held_natives(&node->cope, &reduced);
+        packet = &reduced;
+        body = reduced.body;
     }
+#endif
+    if(!get_header_num_packets(&packet->header)) return decoded_packets;
 
-    free_list(packets_to_decode);
-    free_list(next_packets_to_decode);
-    clean_hash_table(&already_processed_packets);
+    uint32_t generation = get_header_generation(&packet->header);
+    if(is_decoded_generation(decoder, generation)) return decoded_packets;
+
+    netcoding_generation* state = get_decoding_generation(node, generation);
+
+    // Already received, e.g. retransmitted or overheard twice
+    if(insert_header(&decoder->seen, &packet->header) == 2)
+        return decoded_packets;
+
+    state->last_update = ++decoder->clock;
+    insert_generation_row(state, packet, body, decoded_packets);
+    if(state->rank == NETCODING_GENERATION_SIZE)
+        acknowledge_decoded_generation(decoder, generation);
+    for(linked_list_node* cur_node = decoded_packets->head; cur_node;
+        cur_node = cur_node->next) {
+        NETCODING_EVENT(
+            &node->stats,
+            NETCODING_EVENT_DECODED,
+            ((netcoding_packet*)cur_node->data)->header.holding_packets[0]);
+    }
 
     return decoded_packets;
 }
 
+/**
+ * @brief Given an node and the packet, returns a list with all the packets
+ * decoded thanks to it, reference `decode_packets_view`.
+ *
+ * @param node
+ * @param packet
+ * @return struct linked_list_t*
+ */
+static struct linked_list_t* decode_packets(netcoding_node* node,
+                                            netcoding_packet* packet) {
+    return decode_packets_view(node, packet, packet->body);
+}
+
 #endif /* NET_CODING_H_ */
\ No newline at end of file
@@ -3,6 +3,13 @@
 
 #include <stdlib.h>
 #include "buffer.h"
+#include "hash_table.h"
+#include "lib/random.h"
+#include "net/link-stats.h"
+#include "stats.h"
+#if NETCODING_COPE
+#include "cope.h"
+#endif
 
 /* ------------------- NODE ------------------------------------------------- */
 
@@ -10,7 +17,267 @@
  * @brief The probability to combine a packet.
  *
  */
+#ifdef NETCODING_CONF_COMBINATION_RATE
+#define COMBINATION_PERCENTAGE_RATE NETCODING_CONF_COMBINATION_RATE
+#else
 #define COMBINATION_PERCENTAGE_RATE 30
+#endif
+
+/**
+ * @brief The number of frames waiting for the MAC from which the queue policy
+ * combines packets.
+ *
+ */
+#ifdef NETCODING_CONF_QUEUE_THRESHOLD
+#define NETCODING_QUEUE_THRESHOLD NETCODING_CONF_QUEUE_THRESHOLD
+#else
+#define NETCODING_QUEUE_THRESHOLD 2
+#endif
+
+/**
+ * @brief Whether the nodes code systematically: native packets are always
+ * forwarded right away, as without network coding, and every node adds coded
+ * repair packets of the natives it forwarded, so the receivers recover the
+ * lost ones. It applies to the XOR and RLNC modes.
+ *
+ */
+#ifdef NETCODING_CONF_SYSTEMATIC
+#define NETCODING_SYSTEMATIC NETCODING_CONF_SYSTEMATIC
+#else
+#define NETCODING_SYSTEMATIC 0
+#endif
+
+/**
+ * @brief The number of repair packets per 100 native packets forwarded, on
+ * the systematic coding.
+ *
+ */
+#ifdef NETCODING_CONF_REDUNDANCY
+#define NETCODING_REDUNDANCY NETCODING_CONF_REDUNDANCY
+#else
+#define NETCODING_REDUNDANCY 25
+#endif
+
+/**
+ * @brief The seed of the random decisions of every node, combined with its ID
+ * so each node draws a different sequence. 0 seeds it from `random_rand`
+ * instead, which Cooja seeds from the simulation seed.
+ *
+ */
+#ifdef NETCODING_CONF_SEED
+#define NETCODING_SEED NETCODING_CONF_SEED
+#else
+#define NETCODING_SEED 0
+#endif
+
+/**
+ * @brief How the packets are combined.
+ *
+ */
+typedef enum netcoding_mode_t {
+    /**
+     * @brief Up to NUM_COMBINATIONS disjoint packets XORed together.
+     *
+     */
+    NETCODING_MODE_XOR,
+    /**
+     * @brief Random linear network coding over GF(2^8). Packets of the same
+     * generation are combined with random coefficients, so routers can recode
+     * already coded packets without decoding them.
+     *
+     */
+    NETCODING_MODE_RLNC,
+    /**
+     * @brief Opportunistic XOR coding (COPE). A router only combines native
+     * packets going to different next hops when each next hop is known to
+     * hold all the other ones, so each of them decodes its own packet. It
+     * requires NETCODING_COPE.
+     *
+     */
+    NETCODING_MODE_COPE,
+} netcoding_mode;
+
+/**
+ * @brief The coding mode of every node. All the nodes of a network must agree
+ * on it.
+ *
+ */
+#ifdef NETCODING_CONF_MODE
+#define NETCODING_MODE NETCODING_CONF_MODE
+#elif NETCODING_COPE
+#define NETCODING_MODE NETCODING_MODE_COPE
+#else
+#define NETCODING_MODE NETCODING_MODE_XOR
+#endif
+
+/**
+ * @brief The longest time a packet is withheld waiting for another one to be
+ * combined with. Once it expires, the packet is sent with whatever it can be
+ * combined with, or as it is.
+ *
+ */
+#ifdef NETCODING_CONF_MAX_HOLD_DELAY
+#define NETCODING_MAX_HOLD_DELAY NETCODING_CONF_MAX_HOLD_DELAY
+#else
+#define NETCODING_MAX_HOLD_DELAY (CLOCK_SECOND / 2)
+#endif
+
+/**
+ * @brief The most packets withheld at the same time by a node, at most
+ * NETCODING_WINDOW_SIZE per buffer. Beyond it, packets are routed right away.
+ *
+ */
+#ifdef NETCODING_CONF_MAX_OCCUPANCY
+#define NETCODING_MAX_OCCUPANCY NETCODING_CONF_MAX_OCCUPANCY
+#else
+#define NETCODING_MAX_OCCUPANCY NETCODING_WINDOW_SIZE
+#endif
+
+/**
+ * @brief Number of generations decoded at the same time. When a packet of a new
+ * generation arrives and all of them are in use, the least recently updated
+ * one is discarded.
+ *
+ */
+#ifdef NETCODING_CONF_DECODE_GENERATIONS
+#define NETCODING_DECODE_GENERATIONS NETCODING_CONF_DECODE_GENERATIONS
+#else
+#define NETCODING_DECODE_GENERATIONS 4
+#endif
+
+/**
+ * @brief Number of receivers whose acknowledgments a node keeps, one coding
+ * window each. The acknowledgments of further receivers are ignored.
+ *
+ */
+#ifdef NETCODING_CONF_RECEIVERS
+#define NETCODING_RECEIVERS NETCODING_CONF_RECEIVERS
+#else
+#define NETCODING_RECEIVERS 4
+#endif
+
+/**
+ * @brief The decoding state of a generation, kept in reduced row echelon form
+ * across packet arrivals.
+ *
+ */
+typedef struct netcoding_generation_t {
+    uint32_t generation;
+    /**
+     * @brief Number of linearly independent packets received. 0 means this
+     * slot is free.
+     *
+     */
+    int rank;
+    /**
+     * @brief The decoder clock value of the last update, for the eviction.
+     *
+     */
+    uint32_t last_update;
+    /**
+     * @brief Row `i` is valid only if there is a packet whose pivot (its first
+     * non zero coefficient, normalized to 1) is the column `i`.
+     *
+     */
+    bool has_pivot[NETCODING_GENERATION_SIZE];
+    /**
+     * @brief Whether the packet of each column was already delivered.
+     *
+     */
+    bool decoded[NETCODING_GENERATION_SIZE];
+    uint8_t coefficients[NETCODING_GENERATION_SIZE][NETCODING_GENERATION_SIZE];
+    uint8_t payloads[NETCODING_GENERATION_SIZE][PAYLOAD_SIZE];
+} netcoding_generation;
+
+/**
+ * @brief The state of `decode_packets`. It is kept preallocated inside the
+ * node, so decoding a packet does not touch the heap.
+ *
+ */
+typedef struct netcoding_decoder_t {
+    /**
+     * @brief The packets resulting from the last decodification.
+     *
+     */
+    packet_buffer decoded_packets;
+    struct memb list_pool;
+    uint32_t list_pool_used[MEMB_USED_WORDS(NETCODING_GENERATION_SIZE)];
+    netcoding_slot list_pool_mem[NETCODING_GENERATION_SIZE];
+    uint32_t clock;
+    netcoding_generation generations[NETCODING_DECODE_GENERATIONS];
+    /**
+     * @brief The headers already received of the generations being decoded,
+     * so duplicated packets are dropped before reducing them.
+     *
+     */
+    header_set seen;
+    /**
+     * @brief The cumulative acknowledgment: the lowest generation not fully
+     * decoded yet, every older one was or was given up on, reference
+     * `acknowledge_decoded_generation`.
+     *
+     */
+    uint32_t acked_generation;
+    /**
+     * @brief The generations fully decoded past one still missing: bit `i`
+     * stands for generation `acked_generation + i`, so bit 0 is always clear.
+     *
+     */
+    uint32_t decoded_ahead;
+} netcoding_decoder;
+
+/**
+ * @brief A flow, the packets withheld towards the same next hop and
+ * destination. Its queue is made of the slots of the flow in both buffers.
+ *
+ */
+typedef struct netcoding_flow_t {
+    netcoding_addr next_hop;
+    netcoding_addr destination;
+} netcoding_flow;
+
+/**
+ * @brief The coding window of a receiver, out of its acknowledgments: it
+ * fully decoded every generation below `base` and the ones flagged in
+ * `decoded_ahead`, where bit `i` stands for generation `base + i`.
+ *
+ */
+typedef struct netcoding_window_t {
+    netcoding_addr receiver;
+    uint32_t base;
+    uint32_t decoded_ahead;
+} netcoding_window;
+
+struct netcoding_node_t;
+
+/**
+ * @brief Decides whether a packet about to be routed should be combined, or
+ * withheld to be combined later. The available ones are
+ * in the COMBINATION POLICIES section below.
+ *
+ */
+typedef int (*netcoding_policy)(struct netcoding_node_t*,
+                                netcoding_packet*,
+                                netcoding_route*);
+
+/**
+ * @brief The combination policy of every node, e.g.
+ * -DNETCODING_CONF_POLICY=netcoding_policy_etx.
+ *
+ */
+#ifdef NETCODING_CONF_POLICY
+#define NETCODING_POLICY NETCODING_CONF_POLICY
+#else
+#define NETCODING_POLICY netcoding_policy_probability
+#endif
+
+/**
+ * @brief Sends a flushed packet on its route. It must not route it through the
+ * network coding again.
+ *
+ */
+typedef void (*netcoding_transmit_callback)(netcoding_packet*,
+                                            netcoding_route*);
 
 /**
  * @brief A node in the network that communicates in the network coding
@@ -24,10 +291,43 @@ typedef struct netcoding_node_t {
      */
     int id;
     /**
-     * @brief The probability to combine a packet.
+     * @brief How this node combines and decodes packets.
+     *
+     */
+    netcoding_mode mode;
+    /**
+     * @brief How this node decides to combine a packet.
+     *
+     */
+    netcoding_policy policy;
+    /**
+     * @brief The probability to combine a packet, in percent.
      *
      */
     int prob_to_combine;
+    /**
+     * @brief The MAC backlog from which the queue policy combines packets.
+     *
+     */
+    int queue_threshold;
+    /**
+     * @brief Whether this node codes systematically, reference
+     * NETCODING_SYSTEMATIC.
+     *
+     */
+    bool systematic;
+    /**
+     * @brief The repair packets sent per 100 native packets forwarded, on the
+     * systematic coding, and the repairs owed so far, in hundredths.
+     *
+     */
+    int redundancy;
+    int repair_credit;
+    /**
+     * @brief The state of the random sequence of this node, never 0.
+     *
+     */
+    uint32_t random_state;
     /**
      * @brief The buffer with the modified packets waiting to be combined.
      *
@@ -39,15 +339,297 @@ typedef struct netcoding_node_t {
      *
      */
     packet_buffer raw_buffer;
+    /**
+     * @brief Fixed storage backing the buffers above.
+     *
+     */
+    struct memb combination_pool;
+    uint32_t combination_pool_used[MEMB_USED_WORDS(NETCODING_WINDOW_SIZE)];
+    netcoding_slot combination_pool_mem[NETCODING_WINDOW_SIZE];
+    struct memb raw_pool;
+    uint32_t raw_pool_used[MEMB_USED_WORDS(NETCODING_WINDOW_SIZE)];
+    netcoding_slot raw_pool_mem[NETCODING_WINDOW_SIZE];
+    /**
+     * @brief Indexes of the buffers above, to find fitting packets quickly.
+     *
+     */
+    packet_index combination_index;
+    packet_index raw_index;
+    /**
+     * @brief The flows of the withheld packets. A flow is free once its queue
+     * is empty.
+     *
+     */
+    netcoding_flow flows[NETCODING_FLOWS];
+    /**
+     * @brief The coding windows of the receivers, free while their receiver
+     * is NETCODING_ADDR_NONE. The withheld packets of the generations a
+     * receiver fully decoded are evicted, and its coded packets of them are
+     * no longer routed.
+     *
+     */
+    netcoding_window windows[NETCODING_RECEIVERS];
+    /**
+     * @brief The decoding state, one matrix per generation being decoded.
+     *
+     */
+    netcoding_decoder decoder;
+    /**
+     * @brief Expires at the deadline of the oldest withheld packet.
+     *
+     */
+    struct ctimer hold_timer;
+    /**
+     * @brief How withheld packets are sent once flushed, or NULL to drop them.
+     *
+     */
+    netcoding_transmit_callback transmit;
+    /**
+     * @brief The event counters and trace ring of this node.
+     *
+     */
+    netcoding_stats stats;
+#if NETCODING_COPE
+    /**
+     * @brief What this node and its neighbors hold, on the COPE mode.
+     *
+     */
+    netcoding_cope cope;
+#endif
 } netcoding_node;
 
 extern netcoding_node network_coding_node;
 
+/**
+ * @brief Seeds the random sequence of a node, so its decisions can be
+ * reproduced.
+ *
+ * @param node
+ * @param seed
+ */
+static inline void seed_netcoding_node(netcoding_node* node, uint32_t seed) {
+    node->random_state = seed ? seed : 1;
+}
+
+/**
+ * @brief Draws the next number of the random sequence of a node (xorshift32).
+ * Each node has its own sequence, so its decisions do not depend on the other
+ * users of `random_rand`, e.g. the MAC backoffs.
+ *
+ * @param node
+ * @return uint32_t
+ */
+static inline uint32_t netcoding_random(netcoding_node* node) {
+    uint32_t x = node->random_state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return node->random_state = x;
+}
+
+/* ------------------- FLOWS ------------------------------------------------ */
+/**
+ * @brief Get the queue of a flow, i.e., its slots in a buffer.
+ *
+ * @param buffer
+ * @param flow
+ * @return uint32_t*
+ */
+static inline uint32_t* get_flow_slots(packet_buffer* buffer, int flow) {
+    return buffer->index->by_flow[flow];
+}
+
+/**
+ * @brief Counts the packets withheld in the queue of a flow.
+ *
+ * @param node
+ * @param flow
+ * @return int
+ */
+static int get_flow_size(netcoding_node* node, int flow) {
+    return count_slots(get_flow_slots(&node->raw_buffer, flow))
+           + count_slots(get_flow_slots(&node->combination_buffer, flow));
+}
+
+/**
+ * @brief Get the flow of a route, taking a free one if it has none.
+ *
+ * @param node
+ * @param route
+ * @return uint8_t The flow, or NETCODING_FLOW_NONE if the route is unknown or
+ * there is no free flow.
+ */
+static uint8_t get_flow(netcoding_node* node, netcoding_route* route) {
+    int free_flow = NETCODING_FLOW_NONE;
+
+    if(!route || route->next_hop == NETCODING_ADDR_NONE)
+        return NETCODING_FLOW_NONE;
+
+    for(int i = 0; i < NETCODING_FLOWS; i++) {
+        netcoding_flow* flow = &node->flows[i];
+        int is_used = get_flow_size(node, i) > 0;
+
+        if(is_used && flow->next_hop == route->next_hop
+           && flow->destination == route->destination)
+            return i;
+        if(!is_used && free_flow == NETCODING_FLOW_NONE) free_flow = i;
+    }
+    if(free_flow == NETCODING_FLOW_NONE) return NETCODING_FLOW_NONE;
+
+    node->flows[free_flow].next_hop = route->next_hop;
+    node->flows[free_flow].destination = route->destination;
+    return free_flow;
+}
+
+/* ------------------- WINDOWS ---------------------------------------------- */
+/**
+ * @brief Get the coding window of a receiver.
+ *
+ * @param node
+ * @param receiver The receiver, or NETCODING_ADDR_NONE for a free window.
+ * @return netcoding_window* The window or NULL if there is none.
+ */
+static netcoding_window* get_receiver_window(netcoding_node* node,
+                                             netcoding_addr receiver) {
+    for(int i = 0; i < NETCODING_RECEIVERS; i++)
+        if(node->windows[i].receiver == receiver) return &node->windows[i];
+    return NULL;
+}
+
+/**
+ * @brief Verifies if a receiver acknowledged that it fully decoded a
+ * generation.
+ *
+ * @param node
+ * @param receiver
+ * @param generation
+ * @return int
+ */
+static int is_generation_acked(netcoding_node* node,
+                               netcoding_addr receiver,
+                               uint32_t generation) {
+    netcoding_window* window;
+
+    if(receiver == NETCODING_ADDR_NONE) return 0;
+    if(!(window = get_receiver_window(node, receiver))) return 0;
+    if(generation < window->base) return 1;
+    return generation - window->base < 32
+           && (window->decoded_ahead >> (generation - window->base)) & 1;
+}
+
+/* ------------------- COMBINATION POLICIES --------------------------------- */
+/**
+ * @brief Combines a packet with a probability of `prob_to_combine` percent.
+ *
+ * @param node
+ * @param packet
+ * @param route
+ * @return int
+ */
+static int netcoding_policy_probability(netcoding_node* node,
+                                        netcoding_packet* packet,
+                                        netcoding_route* route) {
+    return netcoding_random(node) % 100 < (uint32_t)node->prob_to_combine;
+}
+
+/**
+ * @brief Combines a packet only when at least `queue_threshold` frames are
+ * waiting for the MAC, so packets are withheld only when the link is already
+ * busy and sent right away otherwise.
+ *
+ * @param node
+ * @param packet
+ * @param route
+ * @return int
+ */
+static inline int netcoding_policy_queue(netcoding_node* node,
+                                         netcoding_packet* packet,
+                                         netcoding_route* route) {
+    return route && route->backlog >= node->queue_threshold;
+}
+
+/**
+ * @brief Combines a packet with a probability of `prob_to_combine` percent
+ * scaled by the ETX of its next hop, since each transmission saved on a lossy
+ * link saves its retransmissions as well. The plain probability is used while
+ * the ETX is unknown.
+ *
+ * @param node
+ * @param packet
+ * @param route
+ * @return int
+ */
+static inline int netcoding_policy_etx(netcoding_node* node,
+                                       netcoding_packet* packet,
+                                       netcoding_route* route) {
+    uint32_t prob = node->prob_to_combine;
+
+    if(route && route->etx) prob = prob * route->etx / LINK_STATS_ETX_DIVISOR;
+    return netcoding_random(node) % 100 < prob;
+}
+
+static inline void init_decoder(netcoding_decoder* decoder) {
+    init_pool(&decoder->list_pool,
+              decoder->list_pool_used,
+              decoder->list_pool_mem,
+              sizeof(netcoding_slot),
+              NETCODING_GENERATION_SIZE);
+    start_list(&decoder->decoded_packets, &decoder->list_pool);
+    decoder->clock = 0;
+    memset(decoder->generations, 0, sizeof(decoder->generations));
+    init_header_set(&decoder->seen);
+    decoder->acked_generation = 0;
+    decoder->decoded_ahead = 0;
+}
+
 static inline void create_netcoding_node(int id) {
-    network_coding_node.id = id;
-    network_coding_node.prob_to_combine = 0;
-    network_coding_node.combination_buffer = create_buffer();
-    network_coding_node.raw_buffer = create_buffer();
+    netcoding_node* node = &network_coding_node;
+
+    node->id = id;
+    node->mode = NETCODING_MODE;
+    node->policy = NETCODING_POLICY;
+    node->prob_to_combine = 0;
+    node->queue_threshold = NETCODING_QUEUE_THRESHOLD;
+    node->systematic = NETCODING_SYSTEMATIC;
+    node->redundancy = NETCODING_REDUNDANCY;
+    node->repair_credit = 0;
+    if(NETCODING_SEED)
+        seed_netcoding_node(node, NETCODING_SEED * 2654435761u + id);
+    else
+        seed_netcoding_node(
+            node, ((uint32_t)random_rand() << 16 | random_rand()) + id);
+    init_pool(&node->combination_pool,
+              node->combination_pool_used,
+              node->combination_pool_mem,
+              sizeof(netcoding_slot),
+              NETCODING_WINDOW_SIZE);
+    init_pool(&node->raw_pool,
+              node->raw_pool_used,
+              node->raw_pool_mem,
+              sizeof(netcoding_slot),
+              NETCODING_WINDOW_SIZE);
+    start_indexed_list(&node->combination_buffer,
+                       &node->combination_pool,
+                       &node->combination_index);
+    start_indexed_list(
+        &node->raw_buffer, &node->raw_pool, &node->raw_index);
+    for(int i = 0; i < NETCODING_FLOWS; i++) {
+        node->flows[i].next_hop = NETCODING_ADDR_NONE;
+        node->flows[i].destination = NETCODING_ADDR_NONE;
+    }
+    for(int i = 0; i < NETCODING_RECEIVERS; i++) {
+        node->windows[i].receiver = NETCODING_ADDR_NONE;
+        node->windows[i].base = 0;
+        node->windows[i].decoded_ahead = 0;
+    }
+    init_decoder(&node->decoder);
+    ctimer_stop(&node->hold_timer);
+    node->transmit = NULL;
+    init_stats(&node->stats);
+#if NETCODING_COPE
+    init_cope(&node->cope);
+#endif
 }
 
 static inline void create_netcoding_combinatory_routing_node(int id) {
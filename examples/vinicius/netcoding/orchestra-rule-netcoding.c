@@ -0,0 +1,156 @@
+#include "contiki.h"
+
+#if BUILD_WITH_ORCHESTRA
+
+#include "net/ipv6/uip-ds6-route.h"
+#include "net/packetbuf.h"
+#include "netcoding-layer.h"
+#include "orchestra.h"
+
+/**
+ * @brief An Orchestra rule giving the coded frames their own slotframe, for
+ * RPL storing mode (it knows the children through the routing table). Every
+ * node has a shared Tx cell at the hash of its address, where it sends its
+ * coded frames, and listens at the cells of its parent and children, which
+ * are the next hops of their coded frames. So the next hops of a coded frame
+ * are all awake in the slot it is sent, and the ones it is not addressed to
+ * overhear it (TSCH_CALLBACK_OVERHEARD), as COPE expects. It is enabled by
+ * adding it to the rules before the unicast one, e.g.
+ * #define ORCHESTRA_CONF_RULES { &eb_per_time_source, &netcoding_coded_cells,
+ * &unicast_per_neighbor_rpl_storing, &default_common }
+ *
+ */
+
+/**
+ * @brief Length of the slotframe of the coded frames. It should be coprime
+ * with the other slotframe lengths.
+ *
+ */
+#ifdef NETCODING_CONF_ORCHESTRA_PERIOD
+#define NETCODING_ORCHESTRA_PERIOD NETCODING_CONF_ORCHESTRA_PERIOD
+#else
+#define NETCODING_ORCHESTRA_PERIOD 11
+#endif
+
+/**
+ * @brief Channel offset of the cells of the coded frames.
+ *
+ */
+#ifdef NETCODING_CONF_ORCHESTRA_CHANNEL_OFFSET
+#define NETCODING_ORCHESTRA_CHANNEL_OFFSET \
+    NETCODING_CONF_ORCHESTRA_CHANNEL_OFFSET
+#else
+#define NETCODING_ORCHESTRA_CHANNEL_OFFSET ORCHESTRA_UNICAST_MIN_CHANNEL_OFFSET
+#endif
+
+#if UIP_MAX_ROUTES != 0
+
+static uint16_t slotframe_handle;
+static struct tsch_slotframe* sf_coded;
+
+/* ------------------- CELLS ------------------------------------------------ */
+static uint16_t get_node_timeslot(const linkaddr_t* addr) {
+    return ORCHESTRA_LINKADDR_HASH(addr) % NETCODING_ORCHESTRA_PERIOD;
+}
+
+/**
+ * @brief Sets the cells of the slotframe to the ones this node needs: its Tx
+ * cell and an Rx cell per neighbor (the parent and the children). A timeslot
+ * shared by several of them gets a single cell with all their options.
+ *
+ */
+static void update_cells(void) {
+    uint8_t options[NETCODING_ORCHESTRA_PERIOD] = {0};
+
+    if(sf_coded == NULL) return;
+
+    options[get_node_timeslot(&linkaddr_node_addr)] |=
+        LINK_OPTION_TX | LINK_OPTION_SHARED;
+    if(!linkaddr_cmp(&orchestra_parent_linkaddr, &linkaddr_null))
+        options[get_node_timeslot(&orchestra_parent_linkaddr)] |=
+            LINK_OPTION_RX;
+    for(nbr_table_item_t* item = nbr_table_head(nbr_routes); item != NULL;
+        item = nbr_table_next(nbr_routes, item)) {
+        options[get_node_timeslot(nbr_table_get_lladdr(nbr_routes, item))] |=
+            LINK_OPTION_RX;
+    }
+
+    for(uint16_t timeslot = 0; timeslot < NETCODING_ORCHESTRA_PERIOD;
+        timeslot++) {
+        struct tsch_link* link =
+            tsch_schedule_get_link_by_timeslot(sf_coded, timeslot);
+
+        if(!options[timeslot]) {
+            if(link != NULL) tsch_schedule_remove_link(sf_coded, link);
+        }
+        else if(link == NULL || link->link_options != options[timeslot]) {
+            tsch_schedule_add_link(sf_coded,
+                                   options[timeslot],
+                                   LINK_TYPE_NORMAL,
+                                   &tsch_broadcast_address,
+                                   timeslot,
+                                   NETCODING_ORCHESTRA_CHANNEL_OFFSET,
+                                   1);
+        }
+    }
+}
+
+/* ------------------- ORCHESTRA RULE --------------------------------------- */
+static void child_changed(const linkaddr_t* addr) {
+    update_cells();
+}
+
+/**
+ * @brief Sends the data frames carrying a coded packet at the Tx cell of this
+ * node.
+ *
+ */
+static int select_packet(uint16_t* slotframe,
+                         uint16_t* timeslot,
+                         uint16_t* channel_offset) {
+    const linkaddr_t* dest = packetbuf_addr(PACKETBUF_ADDR_RECEIVER);
+
+    if(packetbuf_attr(PACKETBUF_ATTR_FRAME_TYPE) != FRAME802154_DATAFRAME
+       || orchestra_is_root_schedule_active(dest)
+       || !netcoding_is_coded_frame())
+        return 0;
+
+    if(slotframe != NULL) *slotframe = slotframe_handle;
+    if(timeslot != NULL) *timeslot = get_node_timeslot(&linkaddr_node_addr);
+    if(channel_offset != NULL)
+        *channel_offset = NETCODING_ORCHESTRA_CHANNEL_OFFSET;
+    return 1;
+}
+
+static void new_time_source(const struct tsch_neighbor* old,
+                            const struct tsch_neighbor* new) {
+    const linkaddr_t* new_addr = tsch_queue_get_nbr_address(new);
+
+    if(new == old) return;
+    // Shared with the unicast rules, which may have set it already
+    linkaddr_copy(&orchestra_parent_linkaddr,
+                  new_addr != NULL ? new_addr : &linkaddr_null);
+    update_cells();
+}
+
+static void init(uint16_t sf_handle) {
+    slotframe_handle = sf_handle;
+    sf_coded = tsch_schedule_add_slotframe(slotframe_handle,
+                                           NETCODING_ORCHESTRA_PERIOD);
+    update_cells();
+}
+
+struct orchestra_rule netcoding_coded_cells = {
+    init,
+    new_time_source,
+    select_packet,
+    child_changed,
+    child_changed,
+    NULL,
+    NULL,
+    "network coding coded cells",
+    NETCODING_ORCHESTRA_PERIOD,
+};
+
+#endif /* UIP_MAX_ROUTES */
+#endif /* BUILD_WITH_ORCHESTRA */
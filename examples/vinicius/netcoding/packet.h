@@ -5,26 +5,80 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "contiki.h"
+#include "gf256.h"
 
 /* ------------------- PACKET ----------------------------------------------- */
 /**
  * @brief Max number of combinations per packet.
  *
  */
+#ifdef NETCODING_CONF_NUM_COMBINATIONS
+#define NUM_COMBINATIONS NETCODING_CONF_NUM_COMBINATIONS
+#else
 #define NUM_COMBINATIONS 2
+#endif
 /**
- * @brief Size of the packet payload.
+ * @brief Number of consecutive packet ids per generation. Only packets of the
+ * same generation are combined together, and receivers decode each generation
+ * on its own.
  *
  */
+#ifdef NETCODING_CONF_GENERATION_SIZE
+#define NETCODING_GENERATION_SIZE NETCODING_CONF_GENERATION_SIZE
+#else
+#define NETCODING_GENERATION_SIZE 8
+#endif
+/**
+ * @brief Size of the packet payload. It can be chosen at build time through
+ * NETCODING_CONF_PAYLOAD_SIZE, as long as the whole packet still fits in the
+ * (6LoWPAN fragmented) IPv6 MTU.
+ *
+ */
+#ifdef NETCODING_CONF_PAYLOAD_SIZE
+#define PAYLOAD_SIZE NETCODING_CONF_PAYLOAD_SIZE
+#else
 #define PAYLOAD_SIZE 30
+#endif
+/**
+ * @brief Whether the packets carry the fields of the COPE mode (reference
+ * `NETCODING_MODE_COPE`). Since it changes the packet layout, all the nodes of
+ * a network must agree on it.
+ *
+ */
+#ifdef NETCODING_CONF_COPE
+#define NETCODING_COPE NETCODING_CONF_COPE
+#else
+#define NETCODING_COPE 0
+#endif
+/**
+ * @brief Whether the COPE coded packets are sent as link-layer broadcasts,
+ * which every recipient receives as addressed to it, instead of unicast to
+ * one of them and overheard by the others.
+ *
+ */
+#ifdef NETCODING_CONF_BROADCAST
+#define NETCODING_BROADCAST NETCODING_CONF_BROADCAST
+#else
+#define NETCODING_BROADCAST 0
+#endif
+#if NETCODING_BROADCAST && !NETCODING_COPE
+#error "NETCODING_BROADCAST needs NETCODING_COPE"
+#endif
+/**
+ * @brief Number of reception reports piggybacked on each COPE packet.
+ *
+ */
+#ifdef NETCODING_CONF_REPORT_SIZE
+#define NETCODING_REPORT_SIZE NETCODING_CONF_REPORT_SIZE
+#else
+#define NETCODING_REPORT_SIZE 2
+#endif
 /**
  * @brief Indicates whether this is a invalid packet ID or not.
  *
  */
 #define EMPTY_PACKET_ID UINT32_MAX
-#define PACKET_PREAMBLE "preambulo"
-#define PREAMBLE_SIZE (sizeof(PACKET_PREAMBLE) - 1)
-#define HAS_PREAMBLE(str) (strncmp(str, PACKET_PREAMBLE, PREAMBLE_SIZE) == 0)
 
 /**
  * @brief Header of the packet.
@@ -33,29 +87,73 @@
 typedef struct netcoding_packet_header_t {
     /**
      * @brief The array with all packet ids that have been combined in order to
-     * generate the resulting packet holding this header.
+     * generate the resulting packet holding this header. The ids are kept
+     * sorted, with the EMPTY_PACKET_ID ones (the greatest id) at the end.
      *
      */
     uint32_t holding_packets[NUM_COMBINATIONS];
+    /**
+     * @brief The GF(2^8) coefficient multiplying each of the holding packets.
+     * On XOR coding all of them are 1.
+     *
+     */
+    uint8_t coefficients[NUM_COMBINATIONS];
 } netcoding_packet_header;
 
 /**
- * @brief A network coding packet.
+ * @brief A short node address: the last two bytes of its link-layer address,
+ * which are also the last two bytes of its IPv6 interface identifier.
  *
  */
-typedef struct netcoding_packet_t {
+typedef uint16_t netcoding_addr;
+
+#define NETCODING_ADDR_NONE UINT16_MAX
+#define NETCODING_ADDR(bytes, len) \
+    ((netcoding_addr)((bytes)[(len)-2] << 8 | (bytes)[(len)-1]))
+
+#if NETCODING_COPE
+/**
+ * @brief The COPE fields of a packet, rewritten at every hop.
+ *
+ */
+typedef struct netcoding_cope_info_t {
+    /**
+     * @brief Reception reports: ids of native packets the transmitter holds,
+     * EMPTY_PACKET_ID for the unused ones.
+     *
+     */
+    uint32_t reports[NETCODING_REPORT_SIZE];
     /**
-     * @brief Preamble to help to identify a network coding packet in the Cooja
-     * environment.
+     * @brief The next hops of a coded packet, NETCODING_ADDR_NONE for the
+     * unused ones. Each of them holds all the packets but one, which it
+     * decodes and forwards.
      *
      */
-    char preamble[PREAMBLE_SIZE];
+    netcoding_addr recipients[NUM_COMBINATIONS];
+    /**
+     * @brief Whether the packets of a coded packet go to different
+     * destinations (crossing flows). Then each recipient is the destination
+     * of the packet it decodes, which it delivers instead of forwarding.
+     *
+     */
+    uint8_t crossing;
+} netcoding_cope_info;
+#endif
+
+/**
+ * @brief A network coding packet.
+ *
+ */
+typedef struct netcoding_packet_t {
     /**
      * @brief The packet header holding all the packets ids that have been
      * combined.
      *
      */
     netcoding_packet_header header;
+#if NETCODING_COPE
+    netcoding_cope_info cope;
+#endif
     /**
      * @brief The packet payload resulting from the combination of all the
      * headers packets.
@@ -64,17 +162,17 @@ typedef struct netcoding_packet_t {
     char body[PAYLOAD_SIZE];
 } netcoding_packet;
 
-#define PACKET_SIZE sizeof(netcoding_packet)
-
 static void print_header(netcoding_packet_header* header) {
     for(int i = 0; i < NUM_COMBINATIONS; i++) {
         uint32_t origin = header->holding_packets[i];
+        if(origin != EMPTY_PACKET_ID && header->coefficients[i] != 1)
+            printf("%u*", header->coefficients[i]);
         origin == EMPTY_PACKET_ID ? printf("-1") : printf("%u", origin);
         if(i < NUM_COMBINATIONS - 1) printf(", ");
     }
 }
 
-static void print_packet(netcoding_packet* packet) {
+static inline void print_packet(netcoding_packet* packet) {
     printf("Header: [");
     print_header(&packet->header);
     printf("], Body: [");
@@ -85,7 +183,7 @@ static void print_packet(netcoding_packet* packet) {
     printf("]");
 }
 
-static void print_packet_str(netcoding_packet* packet) {
+static inline void print_packet_str(netcoding_packet* packet) {
     printf("Header: [");
     print_header(&packet->header);
     printf("], Body: \"%s\"", packet->body);
@@ -93,11 +191,19 @@ static void print_packet_str(netcoding_packet* packet) {
 
 static netcoding_packet create_packet(uint32_t packet_id, const char* message) {
     netcoding_packet packet;
-    strcpy(packet.preamble, PACKET_PREAMBLE);
     memset(packet.header.holding_packets,
            EMPTY_PACKET_ID,
            sizeof(packet.header.holding_packets));
+    memset(packet.header.coefficients, 0, sizeof(packet.header.coefficients));
     packet.header.holding_packets[0] = packet_id;
+    packet.header.coefficients[0] = 1;
+#if NETCODING_COPE
+    memset(packet.cope.reports, EMPTY_PACKET_ID, sizeof(packet.cope.reports));
+    memset(
+        packet.cope.recipients, NETCODING_ADDR_NONE, sizeof(packet.cope.recipients));
+    packet.cope.crossing = 0;
+#endif
+    memset(packet.body, 0, PAYLOAD_SIZE);
 
     size_t str_len = strlen(message);
     if(str_len >= PAYLOAD_SIZE) {
@@ -126,12 +232,51 @@ static int get_header_num_packets(netcoding_packet_header* header) {
     return num_pckt;
 }
 
+/**
+ * @brief Get the generation of the packets combined in a header.
+ *
+ * @param header
+ * @return uint32_t
+ */
+static uint32_t get_header_generation(netcoding_packet_header* header) {
+    return header->holding_packets[0] / NETCODING_GENERATION_SIZE;
+}
+
+/**
+ * @brief Counts the packet ids two headers have in common. Since the headers
+ * are sorted, it is a single merge pass over both.
+ *
+ * @param h1
+ * @param h2
+ * @return int
+ */
+static int count_shared_packets(netcoding_packet_header* h1,
+                                netcoding_packet_header* h2) {
+    int i = 0, j = 0, shared = 0;
+
+    while(i < NUM_COMBINATIONS && j < NUM_COMBINATIONS
+          && h1->holding_packets[i] != EMPTY_PACKET_ID
+          && h2->holding_packets[j] != EMPTY_PACKET_ID) {
+        if(h1->holding_packets[i] < h2->holding_packets[j]) i++;
+        else if(h2->holding_packets[j] < h1->holding_packets[i])
+            j++;
+        else {
+            shared++;
+            i++;
+            j++;
+        }
+    }
+    return shared;
+}
+
 /**
  * @brief Verifies if two headers fit themselfs. Two headers fit themselfs if:
  * 1) The number of packets that these two hold do not add up more than
  * NUM_COMBINATIONS (max number of packets per header).
  * 2) The sets of packets ids being hold have to be disjunctive, i.e., there
  * must be no repeated packet id between both of the headers.
+ * 3) Both belong to the same generation, since the receivers decode one
+ * generation at a time.
  *
  * @param inboud_header The reference header.
  * @param comparable_header The header to be compared.
@@ -145,114 +290,504 @@ static int are_fitting_headers(netcoding_packet_header* inboud_header,
     // If the number of packets on h2 would make the final header with more
     // packets then NUM_COMBINATIONS
     if(NUM_COMBINATIONS - num_pckt_h1 < num_pckt_h2) return 0;
+    if(num_pckt_h1 && num_pckt_h2
+       && get_header_generation(inboud_header)
+              != get_header_generation(comparable_header))
+        return 0;
 
-    // Verifies if there are repeated packets on the headers (can only fit
-    // headers if they are disjunctive)
-    for(int i = 0; i < num_pckt_h1; i++) {
-        for(int j = 0; j < num_pckt_h2; j++) {
-            if(inboud_header->holding_packets[i]
-               == comparable_header->holding_packets[j])
-                return 0;
-        }
-    }
+    // Can only fit headers if they are disjunctive
+    return !count_shared_packets(inboud_header, comparable_header);
+}
 
-    return 1;
+/**
+ * @brief Verifies if two headers can be recoded together under RLNC. Unlike
+ * `are_fitting_headers`, the headers may share packets, since each one is
+ * multiplied by a random coefficient, but both must belong to the same
+ * generation and their union must fit in NUM_COMBINATIONS.
+ *
+ * @param inboud_header The reference header.
+ * @param comparable_header The header to be compared.
+ * @return int 1 if both headers can be recoded together and 0 otherwise.
+ */
+static int are_recodable_headers(netcoding_packet_header* inboud_header,
+                                 netcoding_packet_header* comparable_header) {
+    int num_pckt_h1 = get_header_num_packets(inboud_header),
+        num_pckt_h2 = get_header_num_packets(comparable_header);
+
+    if(!num_pckt_h1 || !num_pckt_h2) return 0;
+    if(get_header_generation(inboud_header)
+       != get_header_generation(comparable_header))
+        return 0;
+
+    int union_size = num_pckt_h1 + num_pckt_h2
+                     - count_shared_packets(inboud_header, comparable_header);
+    return union_size <= NUM_COMBINATIONS;
 }
 
+/**
+ * @brief Verifies if two headers hold the same packets with the same
+ * coefficients. Since the headers are sorted, they must match position by
+ * position.
+ *
+ * @param inboud_header
+ * @param comparable_header
+ * @return int
+ */
 static int are_equivalent_headers(netcoding_packet_header* inboud_header,
                                   netcoding_packet_header* comparable_header) {
     for(int i = 0; i < NUM_COMBINATIONS; i++) {
-        int found = 0;
-        for(int j = 0; j < NUM_COMBINATIONS; j++) {
-            if(inboud_header->holding_packets[i]
-               == comparable_header->holding_packets[j]) {
-                found = 1;
-                break;
-            }
-        }
-        if(!found) return 0;
+        if(inboud_header->holding_packets[i]
+           != comparable_header->holding_packets[i])
+            return 0;
+        if(inboud_header->holding_packets[i] == EMPTY_PACKET_ID) return 1;
+        if(inboud_header->coefficients[i] != comparable_header->coefficients[i])
+            return 0;
     }
     return 1;
 }
 
 /**
- * @brief Merge two headers, returning a new one with the union of both packets
- * holding_packets ids. Notice that here the XOR logic is applied, then if a
- * packet `A` appears in both headers, it will no appear in the resulting
- * header. This function assumes both headers agree with the rule 1 in the
- * `are_fitting_headers` function description.
+ * @brief Merge two headers as the linear combination `m1 * h1 + m2 * h2` over
+ * GF(2^8), returning a new one with the union of both packets holding_packets
+ * ids. A packet whose resulting coefficient is 0 vanishes from the merged
+ * header, e.g. with XOR (`m1 = m2 = 1` and unitary coefficients) a packet `A`
+ * appearing in both headers will not appear in the resulting one. Both headers
+ * are merged as sorted lists, so the result is sorted as well. This function
+ * assumes the union of both headers fits in NUM_COMBINATIONS.
  *
  * @param h1 The header 1.
+ * @param m1 The multiplier of the header 1.
  * @param h2 The header 2.
+ * @param m2 The multiplier of the header 2.
  * @return netcoding_packet_header A packet header with the union of both
  * headers packets ids.
  */
-static netcoding_packet_header xor_merge_headers(netcoding_packet_header* h1,
-                                                 netcoding_packet_header* h2) {
+static netcoding_packet_header linear_merge_headers(netcoding_packet_header* h1,
+                                                    uint8_t m1,
+                                                    netcoding_packet_header* h2,
+                                                    uint8_t m2) {
     netcoding_packet_header merged;
-    for(int i = 0; i < NUM_COMBINATIONS; i++)
+    for(int i = 0; i < NUM_COMBINATIONS; i++) {
         merged.holding_packets[i] = EMPTY_PACKET_ID;
+        merged.coefficients[i] = 0;
+    }
 
-    // I'm considering it's impossible to each packet to have repeated packets
-    int filled_index = 0, i = 0;
-    while(h1->holding_packets[i] != EMPTY_PACKET_ID && i < NUM_COMBINATIONS) {
-        int cur_item_count = 1, j = 0;
+    int filled_index = 0, i = 0, j = 0;
+    while(filled_index < NUM_COMBINATIONS) {
+        uint32_t id1 = i < NUM_COMBINATIONS ? h1->holding_packets[i]
+                                            : EMPTY_PACKET_ID;
+        uint32_t id2 = j < NUM_COMBINATIONS ? h2->holding_packets[j]
+                                            : EMPTY_PACKET_ID;
+        uint32_t packet_id = id1 < id2 ? id1 : id2;
+        uint8_t coefficient = 0;
 
-        while(h2->holding_packets[j] != EMPTY_PACKET_ID
-              && j < NUM_COMBINATIONS) {
-            if(h1->holding_packets[i] == h2->holding_packets[j]) {
-                cur_item_count++;
-            }
-            j++;
-        }
-        // Even number of elements, then xor nullify this packet
-        if(cur_item_count % 2) {
-            merged.holding_packets[filled_index++] = h1->holding_packets[i];
+        if(packet_id == EMPTY_PACKET_ID) break;
+        if(id1 == packet_id) coefficient ^= gf256_mul(m1, h1->coefficients[i++]);
+        if(id2 == packet_id) coefficient ^= gf256_mul(m2, h2->coefficients[j++]);
+
+        // The combination nullified this packet
+        if(!coefficient) continue;
+        merged.holding_packets[filled_index] = packet_id;
+        merged.coefficients[filled_index++] = coefficient;
+    }
+
+    return merged;
+}
+
+/**
+ * @brief Merge two headers using the XOR logic, i.e., both multipliers are 1.
+ * Reference `linear_merge_headers`.
+ *
+ * @param h1 The header 1.
+ * @param h2 The header 2.
+ * @return netcoding_packet_header
+ */
+static netcoding_packet_header xor_merge_headers(netcoding_packet_header* h1,
+                                                 netcoding_packet_header* h2) {
+    return linear_merge_headers(h1, 1, h2, 1);
+}
+
+/**
+ * @brief Verifies if a packet is raw (it's a original packet).
+ *
+ * @param packet
+ * @return int
+ */
+static int is_raw_packet(netcoding_packet* packet) {
+    return get_header_num_packets(&packet->header) == 1
+           && packet->header.coefficients[0] == 1;
+}
+
+/* ------------------- WIRE FORMAT ------------------------------------------ */
+/**
+ * @brief The first byte of a network coding packet on the wire. Its five most
+ * significant bits identify the packet and the other ones are the
+ * NETCODING_HEADER_* flags. It is followed by:
+ * 1) The generation, as a varint.
+ * 2) The packet ids, either as a bitmap of the generation or as their count
+ * followed by the varint deltas from the previous one (the first one from the
+ * generation start), whichever is shorter.
+ * 3) One coefficient per packet, only if any of them is not 1.
+ * 4) The COPE fields: the number of reports, the varint reports, the number
+ * of recipients (with NETCODING_COPE_CROSSING) and their 16-bit addresses.
+ * 5) The header size, including this byte, so the header can be found from
+ * the end of the packet.
+ * 6) The PAYLOAD_SIZE bytes of the body.
+ *
+ */
+#define NETCODING_DISPATCH 0xE8
+#define NETCODING_DISPATCH_MASK 0xF8
+/**
+ * @brief The packet ids are a bitmap instead of deltas.
+ *
+ */
+#define NETCODING_HEADER_BITMAP 0x01
+/**
+ * @brief The coefficients follow the packet ids.
+ *
+ */
+#define NETCODING_HEADER_COEFFICIENTS 0x02
+/**
+ * @brief The COPE fields follow the coefficients.
+ *
+ */
+#define NETCODING_HEADER_COPE 0x04
+/**
+ * @brief Set in the number of recipients of a coded packet of crossing flows.
+ *
+ */
+#define NETCODING_COPE_CROSSING 0x80
+
+#define NETCODING_VARINT_MAX_SIZE 5
+#define NETCODING_MEMBERS_BITMAP_SIZE ((NETCODING_GENERATION_SIZE + 7) / 8)
+#define NETCODING_MEMBERS_DELTA_MAX_SIZE \
+    (1 + NUM_COMBINATIONS * NETCODING_VARINT_MAX_SIZE)
+#if NETCODING_COPE
+#define NETCODING_COPE_MAX_SIZE                                 \
+    (2 + NETCODING_REPORT_SIZE * NETCODING_VARINT_MAX_SIZE \
+     + NUM_COMBINATIONS * sizeof(netcoding_addr))
+#else
+#define NETCODING_COPE_MAX_SIZE 0
+#endif
+#define NETCODING_MAX_HEADER_SIZE                                       \
+    (2 + NETCODING_VARINT_MAX_SIZE                                      \
+     + (NETCODING_MEMBERS_BITMAP_SIZE > NETCODING_MEMBERS_DELTA_MAX_SIZE \
+            ? NETCODING_MEMBERS_BITMAP_SIZE                             \
+            : NETCODING_MEMBERS_DELTA_MAX_SIZE)                         \
+     + NUM_COMBINATIONS + NETCODING_COPE_MAX_SIZE)
+/**
+ * @brief The largest size of a packet on the wire.
+ *
+ */
+#define NETCODING_MAX_PACKET_SIZE (NETCODING_MAX_HEADER_SIZE + PAYLOAD_SIZE)
+
+/**
+ * @brief Verifies if a datagram payload is a network coding packet.
+ *
+ */
+#define IS_NETCODING_PACKET(data, len) \
+    ((len) > PAYLOAD_SIZE              \
+     && (((const uint8_t*)(data))[0] & NETCODING_DISPATCH_MASK) == NETCODING_DISPATCH)
+
+static int pack_varint(uint8_t* data, uint32_t value) {
+    int size = 0;
+
+    do {
+        data[size] = value & 0x7F;
+        value >>= 7;
+        if(value) data[size] |= 0x80;
+        size++;
+    } while(value);
+    return size;
+}
+
+/**
+ * @brief Reads a varint.
+ *
+ * @param data
+ * @param len The number of bytes available.
+ * @param value
+ * @return int The number of bytes read, or 0 if it is not valid.
+ */
+static int unpack_varint(const uint8_t* data, int len, uint32_t* value) {
+    *value = 0;
+    for(int i = 0; i < len && i < NETCODING_VARINT_MAX_SIZE; i++) {
+        *value |= (uint32_t)(data[i] & 0x7F) << (7 * i);
+        if(!(data[i] & 0x80)) return i + 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Get the payload of a packet on the wire, always its last
+ * PAYLOAD_SIZE bytes.
+ *
+ */
+#define NETCODING_PACKET_BODY(data, len) ((data) + (len)-PAYLOAD_SIZE)
+
+/**
+ * @brief Writes the wire format of a packet header, up to its header size
+ * byte, so the payload is expected right after it. Reference `pack_packet`.
+ *
+ * @param packet
+ * @param data At least NETCODING_MAX_HEADER_SIZE bytes.
+ * @return int The size of the header on the wire.
+ */
+static int pack_packet_header(netcoding_packet* packet, uint8_t* data) {
+    netcoding_packet_header* header = &packet->header;
+    int num_packets = get_header_num_packets(header);
+    uint32_t generation = num_packets ? get_header_generation(header) : 0;
+    uint32_t previous = generation * NETCODING_GENERATION_SIZE;
+    uint8_t deltas[NETCODING_MEMBERS_DELTA_MAX_SIZE];
+    size_t deltas_size = 1;
+    uint8_t* cur = data + 1;
+
+    data[0] = NETCODING_DISPATCH;
+    cur += pack_varint(cur, generation);
+
+    deltas[0] = num_packets;
+    for(int i = 0; i < num_packets; i++) {
+        deltas_size +=
+            pack_varint(deltas + deltas_size, header->holding_packets[i] - previous);
+        previous = header->holding_packets[i];
+    }
+    if(NETCODING_MEMBERS_BITMAP_SIZE <= deltas_size) {
+        data[0] |= NETCODING_HEADER_BITMAP;
+        memset(cur, 0, NETCODING_MEMBERS_BITMAP_SIZE);
+        for(int i = 0; i < num_packets; i++) {
+            int offset = header->holding_packets[i] % NETCODING_GENERATION_SIZE;
+            cur[offset / 8] |= 1 << (offset % 8);
         }
+        cur += NETCODING_MEMBERS_BITMAP_SIZE;
+    }
+    else {
+        memcpy(cur, deltas, deltas_size);
+        cur += deltas_size;
+    }
 
-        i++;
+    for(int i = 0; i < num_packets; i++) {
+        if(header->coefficients[i] == 1) continue;
+        data[0] |= NETCODING_HEADER_COEFFICIENTS;
+        memcpy(cur, header->coefficients, num_packets);
+        cur += num_packets;
+        break;
     }
 
-    // !TODO: Se um dia puder ter 2A+B por exemplo, isso aq vai ter q ser
-    // alterado, pois se tiver  A em um pacote e 2A em outro, o resultado final
-    // vai ter 2A (1 da primeira iteração e outro dessa abaixo).
-    i = 0;
-    while(h2->holding_packets[i] != EMPTY_PACKET_ID && i < NUM_COMBINATIONS) {
-        int cur_item_count = 1, j = 0;
-
-        while(h1->holding_packets[j] != EMPTY_PACKET_ID
-              && j < NUM_COMBINATIONS) {
-            if(h2->holding_packets[i] == h1->holding_packets[j]) {
-                cur_item_count++;
-            }
-            j++;
+#if NETCODING_COPE
+    uint8_t* count = cur++;
+
+    data[0] |= NETCODING_HEADER_COPE;
+    for(*count = 0; *count < NETCODING_REPORT_SIZE; (*count)++) {
+        if(packet->cope.reports[*count] == EMPTY_PACKET_ID) break;
+        cur += pack_varint(cur, packet->cope.reports[*count]);
+    }
+    count = cur++;
+    for(*count = 0; *count < NUM_COMBINATIONS; (*count)++) {
+        netcoding_addr recipient = packet->cope.recipients[*count];
+        if(recipient == NETCODING_ADDR_NONE) break;
+        *cur++ = recipient >> 8;
+        *cur++ = recipient & 0xFF;
+    }
+    if(packet->cope.crossing) *count |= NETCODING_COPE_CROSSING;
+#endif
+
+    *cur = cur - data + 1;
+    return *cur;
+}
+
+/**
+ * @brief Writes the wire format of a packet.
+ *
+ * @param packet
+ * @param data At least NETCODING_MAX_PACKET_SIZE bytes.
+ * @return int The size of the packet on the wire.
+ */
+static int pack_packet(netcoding_packet* packet, uint8_t* data) {
+    int header_size = pack_packet_header(packet, data);
+
+    memcpy(data + header_size, packet->body, PAYLOAD_SIZE);
+    return header_size + PAYLOAD_SIZE;
+}
+
+/**
+ * @brief Reads the wire format of a packet header, leaving the body of the
+ * packet untouched. The payload can be then used where it lies, through
+ * NETCODING_PACKET_BODY, instead of being copied.
+ *
+ * @param data
+ * @param len The size of the packet on the wire.
+ * @param packet
+ * @return int 1 if it is a valid packet and 0 otherwise.
+ */
+static int unpack_packet_header(const uint8_t* data,
+                                int len,
+                                netcoding_packet* packet) {
+    netcoding_packet_header* header = &packet->header;
+    const uint8_t* end = data + len - PAYLOAD_SIZE - 1;
+    const uint8_t* cur = data + 1;
+    int num_packets = 0, size;
+    uint32_t generation, value;
+
+    if(!IS_NETCODING_PACKET(data, len) || end < cur || *end != end - data + 1)
+        return 0;
+#if !NETCODING_COPE
+    if(data[0] & NETCODING_HEADER_COPE) return 0;
+#endif
+
+    memset(header->holding_packets, EMPTY_PACKET_ID, sizeof(header->holding_packets));
+    memset(header->coefficients, 0, sizeof(header->coefficients));
+    if(!(size = unpack_varint(cur, end - cur, &generation))) return 0;
+    // The ids of the generation must stay below EMPTY_PACKET_ID
+    if(generation >= EMPTY_PACKET_ID / NETCODING_GENERATION_SIZE) return 0;
+    cur += size;
+    value = generation * NETCODING_GENERATION_SIZE;
+
+    if(data[0] & NETCODING_HEADER_BITMAP) {
+        if(end - cur < NETCODING_MEMBERS_BITMAP_SIZE) return 0;
+        for(int offset = 0; offset < NETCODING_GENERATION_SIZE; offset++) {
+            if(!(cur[offset / 8] & (1 << (offset % 8)))) continue;
+            if(num_packets == NUM_COMBINATIONS) return 0;
+            header->holding_packets[num_packets++] = value + offset;
         }
-        // Even number of elements, then xor nullify this packet
-        if(cur_item_count % 2) {
-            merged.holding_packets[filled_index++] = h2->holding_packets[i];
+        cur += NETCODING_MEMBERS_BITMAP_SIZE;
+    }
+    else {
+        if(end - cur < 1 || *cur > NUM_COMBINATIONS) return 0;
+        num_packets = *cur++;
+        for(int i = 0, offset = 0; i < num_packets; i++) {
+            uint32_t delta;
+            if(!(size = unpack_varint(cur, end - cur, &delta))) return 0;
+            cur += size;
+            // The ids are sorted, unique and inside the generation
+            if((i && !delta) || delta >= NETCODING_GENERATION_SIZE - offset)
+                return 0;
+            offset += delta;
+            header->holding_packets[i] = value + offset;
         }
+    }
 
-        i++;
+    for(int i = 0; i < num_packets; i++) header->coefficients[i] = 1;
+    if(data[0] & NETCODING_HEADER_COEFFICIENTS) {
+        if(end - cur < num_packets) return 0;
+        memcpy(header->coefficients, cur, num_packets);
+        cur += num_packets;
     }
 
-    return merged;
+#if NETCODING_COPE
+    memset(packet->cope.reports, EMPTY_PACKET_ID, sizeof(packet->cope.reports));
+    memset(packet->cope.recipients,
+           NETCODING_ADDR_NONE,
+           sizeof(packet->cope.recipients));
+    packet->cope.crossing = 0;
+    if(data[0] & NETCODING_HEADER_COPE) {
+        if(end - cur < 1 || *cur > NETCODING_REPORT_SIZE) return 0;
+        int num_reports = *cur++;
+        for(int i = 0; i < num_reports; i++) {
+            if(!(size = unpack_varint(cur, end - cur, &packet->cope.reports[i])))
+                return 0;
+            cur += size;
+        }
+        if(end - cur < 1) return 0;
+        packet->cope.crossing = !!(*cur & NETCODING_COPE_CROSSING);
+        int num_recipients = *cur++ & ~NETCODING_COPE_CROSSING;
+        if(num_recipients > NUM_COMBINATIONS) return 0;
+        if(end - cur < num_recipients * 2) return 0;
+        for(int i = 0; i < num_recipients; i++, cur += 2)
+            packet->cope.recipients[i] = cur[0] << 8 | cur[1];
+    }
+#endif
+
+    return cur == end;
 }
 
 /**
- * @brief Verifies if a packet is raw (it's a original packet).
+ * @brief Reads the wire format of a packet.
  *
+ * @param data
+ * @param len The size of the packet on the wire.
  * @param packet
- * @return int
+ * @return int 1 if it is a valid packet and 0 otherwise.
  */
-static int is_raw_packet(netcoding_packet* packet) {
-    return packet->header.holding_packets[1] == EMPTY_PACKET_ID;
+static inline int unpack_packet(const uint8_t* data,
+                                int len,
+                                netcoding_packet* packet) {
+    if(!unpack_packet_header(data, len, packet)) return 0;
+    memcpy(packet->body, NETCODING_PACKET_BODY(data, len), PAYLOAD_SIZE);
+    return 1;
 }
 
-static size_t packet_hash(netcoding_packet* packet) {
-    size_t hash = 0;
-    for(int i = 0; i < NUM_COMBINATIONS; i++)
-        hash += packet->header.holding_packets[i];
-    return hash;
+/**
+ * @brief Get where a packet starts from where it ends, through the header size
+ * stored right before the body.
+ *
+ * @param data The bytes ending with the packet.
+ * @param len
+ * @return int The offset of the packet in the data, or -1 if there is none.
+ */
+static inline int find_packet_start(const uint8_t* data, int len) {
+    if(len < PAYLOAD_SIZE + 2) return -1;
+
+    int start = len - PAYLOAD_SIZE - data[len - PAYLOAD_SIZE - 1];
+    if(start < 0 || !IS_NETCODING_PACKET(data + start, len - start)) return -1;
+    return start;
+}
+
+/* ------------------- ACKNOWLEDGMENTS -------------------------------------- */
+/**
+ * @brief First byte of a decoding acknowledgment, followed by the address of
+ * its receiver, in network order, and the varints of the lowest generation it
+ * did not fully decode and of the bitmap of the ones it fully decoded past
+ * that one. It never matches NETCODING_DISPATCH.
+ *
+ */
+#define NETCODING_ACK_DISPATCH 0xF0
+#define NETCODING_ACK_MAX_SIZE (3 + 2 * NETCODING_VARINT_MAX_SIZE)
+
+/**
+ * @brief Writes an acknowledgment.
+ *
+ * @param receiver The receiver that decoded the generations.
+ * @param base The lowest generation it did not fully decode.
+ * @param decoded_ahead The generations it fully decoded past `base`.
+ * @param data At least NETCODING_ACK_MAX_SIZE bytes.
+ * @return int The number of bytes written.
+ */
+static inline int pack_ack(netcoding_addr receiver,
+                           uint32_t base,
+                           uint32_t decoded_ahead,
+                           uint8_t* data) {
+    uint8_t* cur = data + 3;
+
+    data[0] = NETCODING_ACK_DISPATCH;
+    data[1] = receiver >> 8;
+    data[2] = receiver & 0xFF;
+    cur += pack_varint(cur, base);
+    cur += pack_varint(cur, decoded_ahead);
+    return cur - data;
+}
+
+/**
+ * @brief Reads an acknowledgment.
+ *
+ * @param data
+ * @param len
+ * @param receiver
+ * @param base
+ * @param decoded_ahead
+ * @return int 1 if it is a valid acknowledgment and 0 otherwise.
+ */
+static inline int unpack_ack(const uint8_t* data,
+                             int len,
+                             netcoding_addr* receiver,
+                             uint32_t* base,
+                             uint32_t* decoded_ahead) {
+    if(len < 5 || data[0] != NETCODING_ACK_DISPATCH) return 0;
+    *receiver = (data[1] << 8) | data[2];
+
+    int size = unpack_varint(data + 3, len - 3, base);
+    if(!size) return 0;
+    return unpack_varint(data + 3 + size, len - 3 - size, decoded_ahead)
+           == len - 3 - size;
 }
 
 #endif /* NET_CODING_PACKET_H_ */
\ No newline at end of file
@@ -0,0 +1,209 @@
+#ifndef NET_CODING_STATS_H_
+#define NET_CODING_STATS_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "contiki.h"
+#include "sys/log.h"
+
+/* ------------------- EVENTS ----------------------------------------------- */
+/**
+ * @brief How much the network coding traces, chosen at compile time among the
+ * levels of sys/log.h. The events are always counted, which is all
+ * LOG_LEVEL_NONE costs. LOG_LEVEL_WARN also records the failures in the trace
+ * ring, LOG_LEVEL_INFO records every event and LOG_LEVEL_DBG prints them too,
+ * along with every packet routed.
+ *
+ */
+#ifdef NETCODING_CONF_LOG_LEVEL
+#define NETCODING_LOG_LEVEL NETCODING_CONF_LOG_LEVEL
+#else
+#define NETCODING_LOG_LEVEL LOG_LEVEL_NONE
+#endif
+
+/**
+ * @brief Number of events kept by the trace ring, the newest ones.
+ *
+ */
+#ifdef NETCODING_CONF_TRACE_SIZE
+#define NETCODING_TRACE_SIZE NETCODING_CONF_TRACE_SIZE
+#else
+#define NETCODING_TRACE_SIZE 16
+#endif
+
+/**
+ * @brief The events of the network coding of a node. The ones from
+ * NETCODING_EVENT_DROPPED on are failures.
+ *
+ */
+typedef enum netcoding_event_t {
+    /**
+     * @brief A network coding packet was sent, routed right away or flushed.
+     *
+     */
+    NETCODING_EVENT_SENT,
+    /**
+     * @brief A packet was combined with withheld ones.
+     *
+     */
+    NETCODING_EVENT_CODED,
+    /**
+     * @brief A packet was withheld to be combined later.
+     *
+     */
+    NETCODING_EVENT_STORED,
+    /**
+     * @brief A withheld packet was sent once its hold timer expired.
+     *
+     */
+    NETCODING_EVENT_FLUSHED,
+    /**
+     * @brief A repair packet was made, on the systematic coding.
+     *
+     */
+    NETCODING_EVENT_REPAIR,
+    /**
+     * @brief A native packet was decoded.
+     *
+     */
+    NETCODING_EVENT_DECODED,
+    /**
+     * @brief A packet was not routed: its generation was acknowledged or, on
+     * the COPE mode, this node already forwarded it or is not its recipient.
+     *
+     */
+    NETCODING_EVENT_DROPPED,
+    /**
+     * @brief A packet could not be withheld, the buffers are full.
+     *
+     */
+    NETCODING_EVENT_BUFFER_FULL,
+    /**
+     * @brief The decoder dropped the rows of a generation it did not fully
+     * decode, to make room for another one.
+     *
+     */
+    NETCODING_EVENT_DECODE_FAILURE,
+    NETCODING_NUM_EVENTS
+} netcoding_event;
+
+static const char* const netcoding_event_names[NETCODING_NUM_EVENTS] = {
+    "sent",
+    "coded",
+    "stored",
+    "flushed",
+    "repair",
+    "decoded",
+    "dropped",
+    "buffer-full",
+    "decode-failure",
+};
+
+/**
+ * @brief An event recorded in the trace ring.
+ *
+ */
+typedef struct netcoding_trace_entry_t {
+    clock_time_t time;
+    uint32_t packet_id;
+    uint8_t event;
+} netcoding_trace_entry;
+
+/**
+ * @brief The event counters of a node and, from LOG_LEVEL_WARN on, its trace
+ * ring, where the oldest entry is overwritten first.
+ *
+ */
+typedef struct netcoding_stats_t {
+    uint32_t counters[NETCODING_NUM_EVENTS];
+#if NETCODING_LOG_LEVEL >= LOG_LEVEL_WARN
+    int trace_next;
+    int trace_size;
+    netcoding_trace_entry trace[NETCODING_TRACE_SIZE];
+#endif
+} netcoding_stats;
+
+static inline void init_stats(netcoding_stats* stats) {
+    memset(stats, 0, sizeof(netcoding_stats));
+}
+
+#if NETCODING_LOG_LEVEL >= LOG_LEVEL_WARN
+/**
+ * @brief Records an event in the trace ring, if the log level asks for it.
+ *
+ * @param stats
+ * @param event
+ * @param packet_id The packet of the event, the first one if it holds many.
+ */
+static void trace_event(netcoding_stats* stats,
+                        netcoding_event event,
+                        uint32_t packet_id) {
+    netcoding_trace_entry* entry;
+
+    if(NETCODING_LOG_LEVEL < LOG_LEVEL_INFO && event < NETCODING_EVENT_DROPPED)
+        return;
+
+    entry = &stats->trace[stats->trace_next];
+    entry->time = clock_time();
+    entry->packet_id = packet_id;
+    entry->event = event;
+    stats->trace_next = (stats->trace_next + 1) % NETCODING_TRACE_SIZE;
+    if(stats->trace_size < NETCODING_TRACE_SIZE) stats->trace_size++;
+#if NETCODING_LOG_LEVEL >= LOG_LEVEL_DBG
+    printf("NETCODING %s %lu\n",
+           netcoding_event_names[event],
+           (unsigned long)packet_id);
+#endif
+}
+
+/**
+ * @brief Get an entry of the trace ring.
+ *
+ * @param stats
+ * @param age 0 for the newest entry, up to `trace_size` - 1 for the oldest.
+ * @return netcoding_trace_entry*
+ */
+static inline netcoding_trace_entry* get_trace_entry(netcoding_stats* stats,
+                                                     int age) {
+    return &stats->trace[(stats->trace_next - 1 - age + NETCODING_TRACE_SIZE)
+                         % NETCODING_TRACE_SIZE];
+}
+#endif
+
+/**
+ * @brief Counts an event of a node and traces it, according to
+ * NETCODING_LOG_LEVEL.
+ *
+ */
+#if NETCODING_LOG_LEVEL >= LOG_LEVEL_WARN
+#define NETCODING_EVENT(stats, event, packet_id)    \
+    do {                                            \
+        (stats)->counters[event]++;                 \
+        trace_event((stats), (event), (packet_id)); \
+    } while(0)
+#else
+#define NETCODING_EVENT(stats, event, packet_id) \
+    do {                                         \
+        (stats)->counters[event]++;              \
+        (void)(packet_id);                       \
+    } while(0)
+#endif
+
+/**
+ * @brief Prints the counters in a single line, e.g.
+ * "STATS sent=12 coded=3 ...".
+ *
+ * @param stats
+ */
+static void print_stats(netcoding_stats* stats) {
+    printf("STATS");
+    for(int i = 0; i < NETCODING_NUM_EVENTS; i++) {
+        printf(" %s=%lu",
+               netcoding_event_names[i],
+               (unsigned long)stats->counters[i]);
+    }
+    printf("\n");
+}
+
+#endif /* NET_CODING_STATS_H_ */
@@ -6,10 +6,10 @@
 
 static void netcoding_log_format(const char* type,
                                  int node_id,
-                                 int has_preamble,
+                                 int is_netcoding,
                                  uip_ip6addr_t* addr) {
-    printf("[%s| ID:%d | P:%d", type, node_id, has_preamble);
-    if(has_preamble) {
+    printf("[%s| ID:%d | P:%d", type, node_id, is_netcoding);
+    if(is_netcoding) {
         printf(" | ");
         log_6addr(&UIP_IP_BUF->srcipaddr);
     }
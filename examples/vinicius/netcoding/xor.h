@@ -0,0 +1,91 @@
+#ifndef NET_CODING_XOR_H_
+#define NET_CODING_XOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* ------------------- XOR KERNEL ------------------------------------------- */
+/**
+ * @brief The machine word used by the scalar loop: 32 bits on the Cortex-M
+ * ports, 64 bits on native hosts. It may alias any other type, since payloads
+ * are plain byte arrays, possibly inside the uip buffer.
+ *
+ */
+typedef uintptr_t __attribute__((__may_alias__)) xor_word;
+
+#define XOR_WORD_SIZE sizeof(xor_word)
+
+/**
+ * @brief Verifies if two addresses are equally misaligned, so that after the
+ * same number of leading bytes both of them become word aligned.
+ *
+ */
+#define XOR_SAME_ALIGNMENT(p1, p2) \
+    ((((uintptr_t)(p1)) ^ ((uintptr_t)(p2))) % XOR_WORD_SIZE == 0)
+
+/**
+ * @brief XORs two byte arrays, `dst[i] = src1[i] ^ src2[i]`. The destination
+ * may be any of the sources, which allows accumulating a payload into another
+ * one in place. On the native/Cooja builds it uses SSE2 or AVX2 (when the
+ * compiler targets it, e.g. with -mavx2), otherwise it works a machine word at
+ * a time whenever the three arrays share the same alignment.
+ *
+ * @param dst The array receiving the result.
+ * @param src1
+ * @param src2
+ * @param len The number of bytes to be combined.
+ */
+static void xor_bytes(uint8_t* dst,
+                      const uint8_t* src1,
+                      const uint8_t* src2,
+                      size_t len) {
+    size_t i = 0;
+
+#if defined(__AVX2__)
+    for(; i + sizeof(__m256i) <= len; i += sizeof(__m256i)) {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(src1 + i));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(src2 + i));
+        _mm256_storeu_si256((__m256i*)(dst + i), _mm256_xor_si256(a, b));
+    }
+#endif
+#if defined(__SSE2__)
+    for(; i + sizeof(__m128i) <= len; i += sizeof(__m128i)) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(src1 + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src2 + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(a, b));
+    }
+#endif
+
+    // Unaligned word accesses fault on some cores (e.g. Cortex-M0), then only
+    // use words if the arrays can be aligned together
+    if(XOR_SAME_ALIGNMENT(dst, src1) && XOR_SAME_ALIGNMENT(dst, src2)) {
+        for(; i < len && (uintptr_t)(dst + i) % XOR_WORD_SIZE; i++)
+            dst[i] = src1[i] ^ src2[i];
+
+        for(; i + XOR_WORD_SIZE <= len; i += XOR_WORD_SIZE) {
+            *(xor_word*)(dst + i) =
+                *(const xor_word*)(src1 + i) ^ *(const xor_word*)(src2 + i);
+        }
+    }
+
+    for(; i < len; i++) dst[i] = src1[i] ^ src2[i];
+}
+
+/**
+ * @brief Accumulates `src` into `dst` in place, `dst[i] ^= src[i]`.
+ *
+ * @param dst
+ * @param src
+ * @param len
+ */
+static inline void xor_accumulate(uint8_t* dst, const uint8_t* src, size_t len) {
+    xor_bytes(dst, dst, src, len);
+}
+
+#endif /* NET_CODING_XOR_H_ */
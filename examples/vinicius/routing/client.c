@@ -44,6 +44,8 @@ static void udp_rx_callback(struct simple_udp_connection *c,
 PROCESS_THREAD(udp_client_process, ev, data) {
     static struct etimer periodic_timer;
     static char str[32];
+    static netcoding_packet packet;
+    static uint8_t buffer[NETCODING_MAX_PACKET_SIZE];
     uip_ipaddr_t dest_ipaddr;
     static uint32_t tx_count;
 
@@ -74,13 +76,13 @@ PROCESS_THREAD(udp_client_process, ev, data) {
                 LOG_INFO("Sending request %" PRIu32 " to ", tx_count);
                 LOG_INFO_6ADDR(&dest_ipaddr);
                 LOG_INFO_("\n");
-                snprintf(str,
-                         sizeof(str),
-                         "%s-hello %" PRIu32 "",
-                         PACKET_PREAMBLE,
-                         tx_count);
+                snprintf(str, sizeof(str), "hello %" PRIu32 "", tx_count);
+                packet = create_packet(tx_count, str);
 
-                simple_udp_sendto(&udp_conn, str, strlen(str), &dest_ipaddr);
+                simple_udp_sendto(&udp_conn,
+                                  buffer,
+                                  pack_packet(&packet, buffer),
+                                  &dest_ipaddr);
             }
         }
 
@@ -47,24 +47,54 @@
 #include "contiki.h"
 #include "lib/memb.h"
 
+/*---------------------------------------------------------------------------*/
+/* The index of the lowest clear bit of a bitmap word that is not full */
+static int
+first_free_bit(uint32_t word)
+{
+#ifdef __GNUC__
+  return __builtin_ctzl(~word);
+#else
+  int bit;
+
+  for(bit = 0; word & 1; bit++) {
+    word >>= 1;
+  }
+  return bit;
+#endif
+}
 /*---------------------------------------------------------------------------*/
 void
 memb_init(struct memb *m)
 {
-  memset(m->used, 0, m->num);
+  memset(m->used, 0, MEMB_USED_WORDS(m->num) * sizeof(uint32_t));
   memset(m->mem, 0, m->size * m->num);
+  m->count = 0;
+  m->high_water = 0;
 }
 /*---------------------------------------------------------------------------*/
 void *
 memb_alloc(struct memb *m)
 {
+  int w;
   int i;
 
-  for(i = 0; i < m->num; ++i) {
-    if(m->used[i] == false) {
-      /* If this block was unused, we set the used flag on
-	 and return a pointer to the memory block. */
-      m->used[i] = true;
+  if(m->count == m->num) {
+    return NULL;
+  }
+
+  /* The first block that is not in use is taken, from the lowest
+     bitmap word with a clear bit. */
+  for(w = 0; w < MEMB_USED_WORDS(m->num); ++w) {
+    if(m->used[w] != UINT32_MAX) {
+      i = w * 32 + first_free_bit(m->used[w]);
+      if(i >= m->num) {
+        break;
+      }
+      m->used[w] |= (uint32_t)1 << (i % 32);
+      if(++m->count > m->high_water) {
+        m->high_water = m->count;
+      }
       return (void *)((char *)m->mem + (i * m->size));
     }
   }
@@ -77,24 +107,28 @@ memb_alloc(struct memb *m)
 int
 memb_free(struct memb *m, void *ptr)
 {
+  size_t offset;
   int i;
-  char *ptr2;
 
-  /* Walk through the list of blocks and try to find the block to
-     which the pointer "ptr" points to. */
-  ptr2 = (char *)m->mem;
-  for(i = 0; i < m->num; ++i) {
-    if(ptr2 == (char *)ptr) {
-      /* We've found the block to which "ptr" points, so we check the allocation
-         status to detect the double-free error and free the block. */
-      if (m->used[i] == false)
-        return -1;
-      m->used[i] = false;
-      return 0;
-    }
-    ptr2 += m->size;
+  /* The block to which "ptr" points is found from its offset in the
+     memory of the blocks. */
+  if(!memb_inmemb(m, ptr)) {
+    return -1;
+  }
+  offset = (char *)ptr - (char *)m->mem;
+  if(offset % m->size != 0) {
+    return -1;
+  }
+  i = offset / m->size;
+
+  /* Check the allocation status to detect the double-free error and
+     free the block. */
+  if(!(m->used[i / 32] & ((uint32_t)1 << (i % 32)))) {
+    return -1;
   }
-  return -1;
+  m->used[i / 32] &= ~((uint32_t)1 << (i % 32));
+  m->count--;
+  return 0;
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -107,15 +141,13 @@ memb_inmemb(struct memb *m, void *ptr)
 size_t
 memb_numfree(struct memb *m)
 {
-  int i;
-  size_t num_free = 0;
-
-  for(i = 0; i < m->num; ++i) {
-    if(m->used[i] == false) {
-      ++num_free;
-    }
-  }
-
-  return num_free;
+  return m->num - m->count;
 }
+/*---------------------------------------------------------------------------*/
+size_t
+memb_high_water(struct memb *m)
+{
+  return m->high_water;
+}
+/*---------------------------------------------------------------------------*/
 /** @} */
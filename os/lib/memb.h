@@ -48,6 +48,11 @@
  * memory by the memb_alloc() function, and are deallocated with the
  * memb_free() function.
  *
+ * The allocation state of the blocks is a bitmap, so allocating and
+ * freeing a block takes a bit scan over one word per 32 blocks and a
+ * pointer division, instead of a walk over every block. Each set of
+ * blocks also counts the blocks in use and their high-water mark.
+ *
  * @{
  */
 
@@ -64,9 +69,16 @@
 #define MEMB_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include "sys/cc.h"
 
+/**
+ * The number of words of the allocation bitmap of \a num blocks, for
+ * memory blocks whose storage is not declared with MEMB().
+ */
+#define MEMB_USED_WORDS(num) (((num) + 31) / 32)
+
 /**
  * Declare a memory block.
  *
@@ -89,7 +101,7 @@ MEMB(connections, struct connection, 16);
  *
  */
 #define MEMB(name, structure, num) \
-        static bool CC_CONCAT(name,_memb_used)[num]; \
+        static uint32_t CC_CONCAT(name,_memb_used)[MEMB_USED_WORDS(num)]; \
         static structure CC_CONCAT(name,_memb_mem)[num]; \
         static struct memb name = {sizeof(structure), num, \
                                           CC_CONCAT(name,_memb_used), \
@@ -98,8 +110,13 @@ MEMB(connections, struct connection, 16);
 struct memb {
   unsigned short size;
   unsigned short num;
-  bool *used;
+  /** One bit per block, set while the block is allocated. */
+  uint32_t *used;
   void *mem;
+  /** The number of blocks allocated. */
+  unsigned short count;
+  /** The largest number of blocks allocated at once since memb_init(). */
+  unsigned short high_water;
 };
 
 /**
@@ -150,6 +167,15 @@ int memb_inmemb(struct memb *m, void *ptr);
  */
 size_t memb_numfree(struct memb *m);
 
+/**
+ * Get the occupancy high-water mark of memory blocks, to size their
+ * number after the peak usage of an application.
+ * \param m A set of memory blocks previously declared with MEMB().
+ * \return the largest number of memory blocks allocated at once since
+ * memb_init()
+ */
+size_t memb_high_water(struct memb *m);
+
 /** @} */
 /** @} */
 
@@ -622,6 +622,7 @@ tcpip_ipv6_output(void)
   uip_ds6_nbr_t *nbr = NULL;
   const uip_lladdr_t *linkaddr;
   const uip_ipaddr_t *nexthop;
+  int hook_result = 1;
 
   if(uip_len == 0) {
     return;
@@ -637,6 +638,13 @@ tcpip_ipv6_output(void)
     goto exit;
   }
 
+#ifdef TCPIP_OUTPUT_HOOK
+  hook_result = TCPIP_OUTPUT_HOOK();
+  if(!hook_result) {
+    LOG_INFO("output: datagram taken by the output hook\n");
+    goto exit;
+  }
+#endif /* TCPIP_OUTPUT_HOOK */
 
   if(!NETSTACK_ROUTING.ext_header_update()) {
     /* Packet can not be forwarded */
@@ -645,7 +653,8 @@ tcpip_ipv6_output(void)
     return;
   }
 
-  if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)) {
+  if(uip_is_addr_mcast(&UIP_IP_BUF->destipaddr)
+     || hook_result == TCPIP_OUTPUT_HOOK_BROADCAST) {
     linkaddr = NULL;
     goto send_packet;
   }
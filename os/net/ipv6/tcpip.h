@@ -345,6 +345,19 @@ uint8_t tcpip_output(const uip_lladdr_t *);
  */
 void tcpip_ipv6_output(void);
 
+/* A function called by tcpip_ipv6_output with every outgoing datagram,
+ * either originated or forwarded, before the routing protocol extension
+ * headers are updated, e.g. to implement a layer between IPv6 and the MAC.
+ * It is declared as int f(void), may rewrite the datagram in uip_buf and
+ * returns zero when the datagram must not be sent (dropped or withheld), or
+ * TCPIP_OUTPUT_HOOK_BROADCAST to send it as a link-layer broadcast, whatever
+ * its destination. */
+#define TCPIP_OUTPUT_HOOK_BROADCAST 2
+#ifdef TCPIP_CONF_OUTPUT_HOOK
+#define TCPIP_OUTPUT_HOOK TCPIP_CONF_OUTPUT_HOOK
+int TCPIP_OUTPUT_HOOK(void);
+#endif /* TCPIP_CONF_OUTPUT_HOOK */
+
 /**
  * \brief Is forwarding generally enabled?
  */
@@ -85,6 +85,26 @@ MEMB(routememb, uip_ds6_route_t, UIP_DS6_ROUTE_NB);
 static int num_routes = 0;
 static void rm_routelist_callback(nbr_table_item_t *ptr);
 
+#if UIP_DS6_ROUTE_WITH_INDEX
+#if UIP_DS6_ROUTE_NB < 255
+typedef uint8_t route_index_entry_t;
+#else
+typedef uint16_t route_index_entry_t;
+#endif
+/* Hash index of the routes by prefix and prefix length, with a chain
+   per bucket. Buckets and links hold a routememb index plus one, or 0
+   at the end of a chain. */
+static route_index_entry_t route_index[UIP_DS6_ROUTE_INDEX_SIZE];
+static route_index_entry_t route_index_next[UIP_DS6_ROUTE_NB];
+
+/* The prefix lengths in use, longest first, and how many routes have
+   each of them. A lookup tries each of these lengths in turn. */
+#define ROUTE_NUM_LENGTHS (UIP_DS6_ROUTE_NB < 129 ? UIP_DS6_ROUTE_NB : 129)
+static uint8_t route_lengths[ROUTE_NUM_LENGTHS];
+static route_index_entry_t route_length_count[ROUTE_NUM_LENGTHS];
+static int num_route_lengths;
+#endif /* UIP_DS6_ROUTE_WITH_INDEX */
+
 #endif /* (UIP_MAX_ROUTES != 0) */
 
 /* Default routes are held on the defaultrouterlist and their
@@ -168,6 +188,10 @@ uip_ds6_route_init(void)
 #if (UIP_MAX_ROUTES != 0)
   memb_init(&routememb);
   list_init(routelist);
+#if UIP_DS6_ROUTE_WITH_INDEX
+  memset(route_index, 0, sizeof(route_index));
+  num_route_lengths = 0;
+#endif /* UIP_DS6_ROUTE_WITH_INDEX */
   nbr_table_register(nbr_routes,
                      (nbr_table_callback *)rm_routelist_callback);
 #endif /* (UIP_MAX_ROUTES != 0) */
@@ -271,13 +295,111 @@ uip_ds6_route_num_routes(void)
 #endif /* (UIP_MAX_ROUTES != 0) */
 }
 /*---------------------------------------------------------------------------*/
+#if (UIP_MAX_ROUTES != 0) && UIP_DS6_ROUTE_WITH_INDEX
+/* Get the bucket of a prefix in the route index, hashing the bytes
+   that uip_ipaddr_prefixcmp() compares */
+static int
+route_index_bucket(const uip_ipaddr_t *prefix, uint8_t length)
+{
+  unsigned hash = length;
+  int i;
+  for(i = 0; i < length >> 3; i++) {
+    hash = hash * 31 + prefix->u8[i];
+  }
+  return hash % UIP_DS6_ROUTE_INDEX_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static uip_ds6_route_t *
+route_from_index(route_index_entry_t entry)
+{
+  return &((uip_ds6_route_t *)routememb.mem)[entry - 1];
+}
+/*---------------------------------------------------------------------------*/
+/* Add a route to the index, once its prefix is set */
+static void
+route_index_add(uip_ds6_route_t *r)
+{
+  int bucket = route_index_bucket(&r->ipaddr, r->length);
+  int entry = r - (uip_ds6_route_t *)routememb.mem + 1;
+  int i;
+
+  route_index_next[entry - 1] = route_index[bucket];
+  route_index[bucket] = entry;
+
+  /* Count the prefix length, keeping the lengths longest first */
+  for(i = 0; i < num_route_lengths && route_lengths[i] > r->length; i++);
+  if(i == num_route_lengths || route_lengths[i] != r->length) {
+    memmove(&route_lengths[i + 1], &route_lengths[i],
+            num_route_lengths - i);
+    memmove(&route_length_count[i + 1], &route_length_count[i],
+            (num_route_lengths - i) * sizeof(route_length_count[0]));
+    route_lengths[i] = r->length;
+    route_length_count[i] = 0;
+    num_route_lengths++;
+  }
+  route_length_count[i]++;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a route from the index */
+static void
+route_index_remove(uip_ds6_route_t *r)
+{
+  route_index_entry_t *link = &route_index[route_index_bucket(&r->ipaddr,
+                                                              r->length)];
+  int entry = r - (uip_ds6_route_t *)routememb.mem + 1;
+  int i;
+
+  while(*link != entry) {
+    if(*link == 0) {
+      return;
+    }
+    link = &route_index_next[*link - 1];
+  }
+  *link = route_index_next[entry - 1];
+
+  for(i = 0; i < num_route_lengths && route_lengths[i] != r->length; i++);
+  if(i < num_route_lengths && --route_length_count[i] == 0) {
+    num_route_lengths--;
+    memmove(&route_lengths[i], &route_lengths[i + 1],
+            num_route_lengths - i);
+    memmove(&route_length_count[i], &route_length_count[i + 1],
+            (num_route_lengths - i) * sizeof(route_length_count[0]));
+  }
+}
+/*---------------------------------------------------------------------------*/
+/* Find the route with the longest prefix matching an address, trying
+   the prefix lengths in use from the longest one */
+static uip_ds6_route_t *
+route_index_lookup(const uip_ipaddr_t *addr)
+{
+  route_index_entry_t entry;
+  uip_ds6_route_t *r;
+  int i;
+
+  for(i = 0; i < num_route_lengths; i++) {
+    for(entry = route_index[route_index_bucket(addr, route_lengths[i])];
+        entry != 0;
+        entry = route_index_next[entry - 1]) {
+      r = route_from_index(entry);
+      if(r->length == route_lengths[i] &&
+         uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
+        return r;
+      }
+    }
+  }
+  return NULL;
+}
+#endif /* (UIP_MAX_ROUTES != 0) && UIP_DS6_ROUTE_WITH_INDEX */
+/*---------------------------------------------------------------------------*/
 uip_ds6_route_t *
 uip_ds6_route_lookup(const uip_ipaddr_t *addr)
 {
 #if (UIP_MAX_ROUTES != 0)
+#if !UIP_DS6_ROUTE_WITH_INDEX
   uip_ds6_route_t *r;
-  uip_ds6_route_t *found_route;
   uint8_t longestmatch;
+#endif /* !UIP_DS6_ROUTE_WITH_INDEX */
+  uip_ds6_route_t *found_route;
 
   LOG_INFO("Looking up route for ");
   LOG_INFO_6ADDR(addr);
@@ -287,6 +409,9 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
     return NULL;
   }
 
+#if UIP_DS6_ROUTE_WITH_INDEX
+  found_route = route_index_lookup(addr);
+#else /* UIP_DS6_ROUTE_WITH_INDEX */
   found_route = NULL;
   longestmatch = 0;
   for(r = uip_ds6_route_head();
@@ -302,6 +427,7 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
       }
     }
   }
+#endif /* UIP_DS6_ROUTE_WITH_INDEX */
 
   if(found_route != NULL) {
     LOG_INFO("Found route: ");
@@ -313,6 +439,7 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
     LOG_INFO("No route found\n");
   }
 
+#if !UIP_DS6_ROUTE_WITH_INDEX || UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED
   if(found_route != NULL && found_route != list_head(routelist)) {
     /* If we found a route, we put it at the start of the routeslist
        list. The list is ordered by how recently we looked them up:
@@ -322,6 +449,7 @@ uip_ds6_route_lookup(const uip_ipaddr_t *addr)
     list_remove(routelist, found_route);
     list_push(routelist, found_route);
   }
+#endif /* !UIP_DS6_ROUTE_WITH_INDEX || UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED */
 
   return found_route;
 #else /* (UIP_MAX_ROUTES != 0) */
@@ -464,6 +592,9 @@ uip_ds6_route_add(const uip_ipaddr_t *ipaddr, uint8_t length,
 
   uip_ipaddr_copy(&(r->ipaddr), ipaddr);
   r->length = length;
+#if UIP_DS6_ROUTE_WITH_INDEX
+  route_index_add(r);
+#endif /* UIP_DS6_ROUTE_WITH_INDEX */
 
 #ifdef UIP_DS6_ROUTE_STATE_TYPE
   memset(&r->state, 0, sizeof(UIP_DS6_ROUTE_STATE_TYPE));
@@ -509,6 +640,9 @@ uip_ds6_route_rm(uip_ds6_route_t *route)
 
     /* Remove the route from the route list */
     list_remove(routelist, route);
+#if UIP_DS6_ROUTE_WITH_INDEX
+    route_index_remove(route);
+#endif /* UIP_DS6_ROUTE_WITH_INDEX */
 
     /* Find the corresponding neighbor_route and remove it. */
     for(neighbor_route = list_head(route->neighbor_routes->route_list);
@@ -111,6 +111,24 @@ void uip_ds6_notification_rm(struct uip_ds6_notification *n);
 #define UIP_DS6_ROUTE_NB 4
 #endif /* UIP_MAX_ROUTES */
 
+/* Whether routes are looked up through a hash index per prefix
+   length, at the cost of about three bytes per route, instead of a
+   walk over every route. Lookups then no longer move the route found
+   to the head of the route list, unless
+   UIP_DS6_ROUTE_REMOVE_LEAST_RECENTLY_USED needs that order. */
+#ifdef UIP_DS6_ROUTE_CONF_WITH_INDEX
+#define UIP_DS6_ROUTE_WITH_INDEX UIP_DS6_ROUTE_CONF_WITH_INDEX
+#else /* UIP_DS6_ROUTE_CONF_WITH_INDEX */
+#define UIP_DS6_ROUTE_WITH_INDEX 0
+#endif /* UIP_DS6_ROUTE_CONF_WITH_INDEX */
+
+/* The number of hash buckets of the route index */
+#ifdef UIP_DS6_ROUTE_CONF_INDEX_SIZE
+#define UIP_DS6_ROUTE_INDEX_SIZE UIP_DS6_ROUTE_CONF_INDEX_SIZE
+#else /* UIP_DS6_ROUTE_CONF_INDEX_SIZE */
+#define UIP_DS6_ROUTE_INDEX_SIZE UIP_DS6_ROUTE_NB
+#endif /* UIP_DS6_ROUTE_CONF_INDEX_SIZE */
+
 /** \brief define some additional RPL related route state and
  *  neighbor callback for RPL - if not a DS6_ROUTE_STATE is already set */
 #ifndef UIP_DS6_ROUTE_STATE_TYPE
@@ -58,6 +58,27 @@ static int num_nodes;
 LIST(nodelist);
 MEMB(nodememb, uip_sr_node_t, UIP_SR_LINK_NUM);
 
+#if UIP_SR_WITH_INDEX
+#if UIP_SR_LINK_NUM < 255
+typedef uint8_t node_index_entry_t;
+#else
+typedef uint16_t node_index_entry_t;
+#endif
+/* Hash index of the nodes by link identifier, with a chain per bucket.
+ * Buckets and links hold a nodememb index plus one, or 0 at the end of
+ * a chain */
+static node_index_entry_t node_index[UIP_SR_INDEX_SIZE];
+static node_index_entry_t node_index_next[UIP_SR_LINK_NUM];
+
+/* The version of the links of the graph, and the root that the source
+ * routes kept by the nodes start from. Version 0 is never current */
+static uint16_t links_version;
+static const uip_sr_node_t *links_root;
+
+/* The path length kept by nodes unreachable from the root */
+#define PATH_UNREACHABLE 0xff
+#endif /* UIP_SR_WITH_INDEX */
+
 /*---------------------------------------------------------------------------*/
 int
 uip_sr_num_nodes(void)
@@ -78,23 +99,190 @@ node_matches_address(const void *graph, const uip_sr_node_t *node,
   }
 }
 /*---------------------------------------------------------------------------*/
+/* Tell that a link of the graph changed, so that the nodes compute their
+ * source route again */
+static void
+links_changed(void)
+{
+#if UIP_SR_WITH_INDEX
+  uip_sr_node_t *l;
+  if(++links_version == 0) {
+    /* Make sure that no node kept a route of the first versions */
+    for(l = list_head(nodelist); l != NULL; l = list_item_next(l)) {
+      l->path_version = 0;
+    }
+    links_version = 1;
+  }
+#endif /* UIP_SR_WITH_INDEX */
+}
+/*---------------------------------------------------------------------------*/
+static void
+set_parent(uip_sr_node_t *node, uip_sr_node_t *parent)
+{
+  if(node->parent != parent) {
+    node->parent = parent;
+    links_changed();
+  }
+}
+/*---------------------------------------------------------------------------*/
+#if UIP_SR_WITH_INDEX
+/* Get the bucket of a link identifier in the node index */
+static int
+node_index_bucket(const unsigned char *link_identifier)
+{
+  unsigned hash = 0;
+  int i;
+  for(i = 0; i < 8; i++) {
+    hash = hash * 31 + link_identifier[i];
+  }
+  return hash % UIP_SR_INDEX_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+static uip_sr_node_t *
+node_from_index(node_index_entry_t entry)
+{
+  return &((uip_sr_node_t *)nodememb.mem)[entry - 1];
+}
+/*---------------------------------------------------------------------------*/
+/* Add a node to the index, once its link identifier is set */
+static void
+node_index_add(uip_sr_node_t *node)
+{
+  int bucket = node_index_bucket(node->link_identifier);
+  int entry = node - (uip_sr_node_t *)nodememb.mem + 1;
+
+  node_index_next[entry - 1] = node_index[bucket];
+  node_index[bucket] = entry;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a node from the index */
+static void
+node_index_remove(uip_sr_node_t *node)
+{
+  node_index_entry_t *link = &node_index[node_index_bucket(node->link_identifier)];
+  int entry = node - (uip_sr_node_t *)nodememb.mem + 1;
+
+  while(*link != entry) {
+    if(*link == 0) {
+      return;
+    }
+    link = &node_index_next[*link - 1];
+  }
+  *link = node_index_next[entry - 1];
+}
+#endif /* UIP_SR_WITH_INDEX */
+/*---------------------------------------------------------------------------*/
 uip_sr_node_t *
 uip_sr_get_node(const void *graph, const uip_ipaddr_t *addr)
 {
   uip_sr_node_t *l;
+#if UIP_SR_WITH_INDEX
+  node_index_entry_t entry;
+
+  if(addr == NULL) {
+    return NULL;
+  }
+  for(entry = node_index[node_index_bucket(&addr->u8[8])];
+      entry != 0;
+      entry = node_index_next[entry - 1]) {
+    l = node_from_index(entry);
+    /* Compare node identifier, then prefix */
+    if(memcmp(l->link_identifier, &addr->u8[8], 8) == 0 &&
+       node_matches_address(graph, l, addr)) {
+      return l;
+    }
+  }
+#else /* UIP_SR_WITH_INDEX */
   for(l = list_head(nodelist); l != NULL; l = list_item_next(l)) {
     /* Compare prefix and node identifier */
     if(node_matches_address(graph, l, addr)) {
       return l;
     }
   }
+#endif /* UIP_SR_WITH_INDEX */
   return NULL;
 }
 /*---------------------------------------------------------------------------*/
+/* Count the leading bytes two addresses have in common */
+static int
+count_matching_bytes(const uip_ipaddr_t *addr1, const uip_ipaddr_t *addr2)
+{
+  int i;
+  for(i = 0; i < 16 && addr1->u8[i] == addr2->u8[i]; i++);
+  return i;
+}
+/*---------------------------------------------------------------------------*/
 int
-uip_sr_is_addr_reachable(const void *graph, const uip_ipaddr_t *addr)
+uip_sr_get_path(const uip_sr_node_t *root, uip_sr_node_t *node,
+                uint8_t *path_len, uint8_t *cmpr)
 {
   int max_depth = UIP_SR_LINK_NUM;
+  const uip_sr_node_t *l;
+  uip_ipaddr_t node_ipaddr;
+  uip_ipaddr_t hop_ipaddr;
+  unsigned len;
+  int common;
+
+  if(node == NULL || root == NULL) {
+    return 0;
+  }
+
+#if UIP_SR_WITH_INDEX
+  if(root != links_root) {
+    links_root = root;
+    links_changed();
+  }
+  if(node->path_version == links_version) {
+    if(node->path_len == PATH_UNREACHABLE) {
+      return 0;
+    }
+    if(path_len != NULL) {
+      *path_len = node->path_len;
+    }
+    if(cmpr != NULL) {
+      *cmpr = node->path_cmpr;
+    }
+    return 1;
+  }
+#endif /* UIP_SR_WITH_INDEX */
+
+  /* Walk up to the root. The compression only matters to the caller */
+  len = 0;
+  common = 15;
+  NETSTACK_ROUTING.get_sr_node_ipaddr(&node_ipaddr, node);
+  for(l = node; l != NULL && l != root && max_depth > 0; l = l->parent) {
+    if(l != node) {
+      NETSTACK_ROUTING.get_sr_node_ipaddr(&hop_ipaddr, l);
+      common = MIN(common, count_matching_bytes(&hop_ipaddr, &node_ipaddr));
+      len++;
+    }
+    max_depth--;
+  }
+
+#if UIP_SR_WITH_INDEX
+  /* Keep the route, unless it is too long to be told from unreachable */
+  if(l != root || len < PATH_UNREACHABLE) {
+    node->path_version = links_version;
+    node->path_len = l == root ? len : PATH_UNREACHABLE;
+    node->path_cmpr = common;
+  }
+#endif /* UIP_SR_WITH_INDEX */
+
+  if(l != root) {
+    return 0;
+  }
+  if(path_len != NULL) {
+    *path_len = len;
+  }
+  if(cmpr != NULL) {
+    *cmpr = common;
+  }
+  return 1;
+}
+/*---------------------------------------------------------------------------*/
+int
+uip_sr_is_addr_reachable(const void *graph, const uip_ipaddr_t *addr)
+{
   uip_ipaddr_t root_ipaddr;
   uip_sr_node_t *node;
   uip_sr_node_t *root_node;
@@ -103,11 +291,7 @@ uip_sr_is_addr_reachable(const void *graph, const uip_ipaddr_t *addr)
   node = uip_sr_get_node(graph, addr);
   root_node = uip_sr_get_node(graph, &root_ipaddr);
 
-  while(node != NULL && node != root_node && max_depth > 0) {
-    node = node->parent;
-    max_depth--;
-  }
-  return node != NULL && node == root_node;
+  return uip_sr_get_path(root_node, node, NULL, NULL);
 }
 /*---------------------------------------------------------------------------*/
 void
@@ -153,6 +337,11 @@ uip_sr_update_node(void *graph, const uip_ipaddr_t *child,
       return NULL;
     }
     child_node->parent = NULL;
+    memcpy(child_node->link_identifier, ((const unsigned char *)child) + 8, 8);
+#if UIP_SR_WITH_INDEX
+    child_node->path_version = 0;
+    node_index_add(child_node);
+#endif /* UIP_SR_WITH_INDEX */
     list_add(nodelist, child_node);
     num_nodes++;
   }
@@ -160,22 +349,21 @@ uip_sr_update_node(void *graph, const uip_ipaddr_t *child,
   /* Initialize node */
   child_node->graph = graph;
   child_node->lifetime = lifetime;
-  memcpy(child_node->link_identifier, ((const unsigned char *)child) + 8, 8);
 
   /* Is the node reachable before the update? */
   if(uip_sr_is_addr_reachable(graph, child)) {
     old_parent_node = child_node->parent;
     /* Update node */
-    child_node->parent = parent_node;
+    set_parent(child_node, parent_node);
     /* Has the node become unreachable? May happen if we create a loop. */
     if(!uip_sr_is_addr_reachable(graph, child)) {
       /* The new parent makes the node unreachable, restore old parent.
        * We will take the update next time, with chances we know more of
        * the topology and the loop is gone. */
-      child_node->parent = old_parent_node;
+      set_parent(child_node, old_parent_node);
     }
   } else {
-    child_node->parent = parent_node;
+    set_parent(child_node, parent_node);
   }
 
   LOG_INFO("NS: updating link, child ");
@@ -193,6 +381,11 @@ uip_sr_init(void)
   num_nodes = 0;
   memb_init(&nodememb);
   list_init(nodelist);
+#if UIP_SR_WITH_INDEX
+  memset(node_index, 0, sizeof(node_index));
+  links_version = 1;
+  links_root = NULL;
+#endif /* UIP_SR_WITH_INDEX */
 }
 /*---------------------------------------------------------------------------*/
 uip_sr_node_t *
@@ -235,8 +428,12 @@ uip_sr_periodic(unsigned seconds)
           LOG_INFO_("\n");
         }
         list_remove(nodelist, l);
+#if UIP_SR_WITH_INDEX
+        node_index_remove(l);
+#endif /* UIP_SR_WITH_INDEX */
         memb_free(&nodememb, l);
         num_nodes--;
+        links_changed();
       }
     } else if(l->lifetime != UIP_SR_INFINITE_LIFETIME) {
       l->lifetime = l->lifetime > seconds ? l->lifetime - seconds : 0;
@@ -252,9 +449,13 @@ uip_sr_free_all(void)
   for(l = list_head(nodelist); l != NULL; l = next) {
     next = list_item_next(l);
     list_remove(nodelist, l);
+#if UIP_SR_WITH_INDEX
+    node_index_remove(l);
+#endif /* UIP_SR_WITH_INDEX */
     memb_free(&nodememb, l);
     num_nodes--;
   }
+  links_changed();
 }
 /*---------------------------------------------------------------------------*/
 int
@@ -83,6 +83,22 @@
 #define UIP_SR_REMOVAL_DELAY          60
 #endif /* UIP_SR_CONF_REMOVAL_DELAY */
 
+/* Whether nodes are found from their address through a hash index,
+ * and keep their source route from the root until a link of the graph
+ * changes, at the cost of six to eight bytes per node */
+#ifdef UIP_SR_CONF_WITH_INDEX
+#define UIP_SR_WITH_INDEX UIP_SR_CONF_WITH_INDEX
+#else /* UIP_SR_CONF_WITH_INDEX */
+#define UIP_SR_WITH_INDEX (UIP_SR_LINK_NUM != 0)
+#endif /* UIP_SR_CONF_WITH_INDEX */
+
+/* The number of hash buckets of the node index */
+#ifdef UIP_SR_CONF_INDEX_SIZE
+#define UIP_SR_INDEX_SIZE UIP_SR_CONF_INDEX_SIZE
+#else /* UIP_SR_CONF_INDEX_SIZE */
+#define UIP_SR_INDEX_SIZE UIP_SR_LINK_NUM
+#endif /* UIP_SR_CONF_INDEX_SIZE */
+
 #define UIP_SR_INFINITE_LIFETIME           0xFFFFFFFF
 
 /********** Data Structures  **********/
@@ -98,6 +114,13 @@ typedef struct uip_sr_node {
   us with the prefix */
   unsigned char link_identifier[8];
   struct uip_sr_node *parent;
+#if UIP_SR_WITH_INDEX
+  /* The source route from the root, see uip_sr_get_path(), valid while
+  path_version is the version of the links of the graph */
+  uint16_t path_version;
+  uint8_t path_len;
+  uint8_t path_cmpr;
+#endif /* UIP_SR_WITH_INDEX */
 } uip_sr_node_t;
 
 /********** Public functions **********/
@@ -165,6 +188,22 @@ uip_sr_node_t *uip_sr_get_node(const void *graph, const uip_ipaddr_t *addr);
  */
 int uip_sr_is_addr_reachable(const void *graph, const uip_ipaddr_t *addr);
 
+/**
+ * Gets the source route from the root to a node. With UIP_SR_WITH_INDEX,
+ * it is computed once and kept until a link of the graph changes.
+ *
+ * \param root The root node
+ * \param node The destination node
+ * \param path_len Set to the number of nodes between the root and the
+ * destination, if not NULL
+ * \param cmpr Set to the number of leading bytes that the addresses of these
+ * nodes all share with the address of the destination, at most 15, if not
+ * NULL
+ * \return 1 if the node is reachable from the root, 0 otherwise
+ */
+int uip_sr_get_path(const uip_sr_node_t *root, uip_sr_node_t *node,
+                    uint8_t *path_len, uint8_t *cmpr);
+
 /**
  * A function called periodically. Used to age the links (decrease lifetime
  * and expire links accordingly)
@@ -86,6 +86,16 @@ input_packet(void)
   } else if(!linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER),
                                          &linkaddr_node_addr) &&
             !packetbuf_holds_broadcast()) {
+#ifdef CSMA_OVERHEARING_CALLBACK
+    if(CSMA_OVERHEARING_CALLBACK() && !mac_sequence_is_duplicate()) {
+      mac_sequence_register_seqno();
+      LOG_INFO("overheard packet from ");
+      LOG_INFO_LLADDR(packetbuf_addr(PACKETBUF_ADDR_SENDER));
+      LOG_INFO_(", seqno %u, len %u\n", packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO), packetbuf_datalen());
+      NETSTACK_NETWORK.input();
+      return;
+    }
+#endif /* CSMA_OVERHEARING_CALLBACK */
     LOG_WARN("not for us\n");
   } else if(linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_SENDER), &linkaddr_node_addr)) {
     LOG_WARN("frame from ourselves\n");
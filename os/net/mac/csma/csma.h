@@ -72,6 +72,15 @@
 #define CSMA_AFTER_ACK_DETECTED_WAIT_TIME       RTIMER_SECOND / 1500
 #endif /* CSMA_CONF_AFTER_ACK_DETECTED_WAIT_TIME */
 
+/* A function called with every unicast frame overheard but not addressed
+ * to this node, e.g. to learn from neighbor traffic. It is declared as
+ * int f(void), reads the frame from the packetbuf and returns non-zero when
+ * the frame must be processed as if it was addressed to this node. */
+#ifdef CSMA_CONF_OVERHEARING_CALLBACK
+#define CSMA_OVERHEARING_CALLBACK CSMA_CONF_OVERHEARING_CALLBACK
+int CSMA_OVERHEARING_CALLBACK(void);
+#endif /* CSMA_CONF_OVERHEARING_CALLBACK */
+
 #define CSMA_ACK_LEN 3
 
 /* just a default - with LLSEC, etc */
@@ -912,12 +912,20 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
 #endif /* LLSEC802154_ENABLED */
 
         if(frame_valid) {
+          static int is_for_us;
           /* Check that frome is for us or broadcast, AND that it is not from
            * ourselves. This is for consistency with CSMA and to avoid adding
            * ourselves to neighbor tables in case frames are being replayed. */
-          if((linkaddr_cmp(&destination_address, &linkaddr_node_addr)
-               || linkaddr_cmp(&destination_address, &linkaddr_null))
-             && !linkaddr_cmp(&source_address, &linkaddr_node_addr)) {
+          is_for_us = linkaddr_cmp(&destination_address, &linkaddr_node_addr)
+            || linkaddr_cmp(&destination_address, &linkaddr_null);
+#ifdef TSCH_CALLBACK_OVERHEARD
+          /* Data frames to other nodes are kept as well, to be overheard,
+           * but never acknowledged */
+          frame_valid = is_for_us || frame.fcf.frame_type == FRAME802154_DATAFRAME;
+#else /* TSCH_CALLBACK_OVERHEARD */
+          frame_valid = is_for_us;
+#endif /* TSCH_CALLBACK_OVERHEARD */
+          if(frame_valid && !linkaddr_cmp(&source_address, &linkaddr_node_addr)) {
             int do_nack = 0;
             rx_count++;
             estimated_drift = RTIMER_CLOCK_DIFF(expected_rx_time, rx_start_time);
@@ -935,13 +943,13 @@ PT_THREAD(tsch_rx_slot(struct pt *pt, struct rtimer *t))
 #endif
 
 #ifdef TSCH_CALLBACK_DO_NACK
-            if(frame.fcf.ack_required) {
+            if(frame.fcf.ack_required && is_for_us) {
               do_nack = TSCH_CALLBACK_DO_NACK(current_link,
                   &source_address, &destination_address);
             }
 #endif
 
-            if(frame.fcf.ack_required) {
+            if(frame.fcf.ack_required && is_for_us) {
               static uint8_t ack_buf[TSCH_PACKET_MAX_LEN];
               static int ack_len;
 
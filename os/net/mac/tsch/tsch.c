@@ -1176,6 +1176,20 @@ packet_input(void)
   } else {
     int duplicate = 0;
 
+#ifdef TSCH_CALLBACK_OVERHEARD
+    /* Frames to other nodes are only kept, and their seqno registered, if
+     * the upper layer wants them */
+    if(!linkaddr_cmp(packetbuf_addr(PACKETBUF_ADDR_RECEIVER), &linkaddr_node_addr)
+       && !packetbuf_holds_broadcast()) {
+      if(!TSCH_CALLBACK_OVERHEARD()) {
+        return;
+      }
+      LOG_INFO("overheard frame to ");
+      LOG_INFO_LLADDR(packetbuf_addr(PACKETBUF_ADDR_RECEIVER));
+      LOG_INFO_("\n");
+    }
+#endif /* TSCH_CALLBACK_OVERHEARD */
+
     /* Seqno of 0xffff means no seqno */
     if(packetbuf_attr(PACKETBUF_ATTR_MAC_SEQNO) != 0xffff) {
       /* Check for duplicates */
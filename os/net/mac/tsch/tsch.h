@@ -143,6 +143,13 @@ struct tsch_neighbor;
 void TSCH_CALLBACK_NEW_TIME_SOURCE(const struct tsch_neighbor *old, const struct tsch_neighbor *new);
 #endif
 
+/* Called by TSCH with a data frame addressed to another node, e.g. received
+ * in a shared cell. It returns 1 for the frame to be processed as if addressed
+ * to this node, and 0 for it to be dropped */
+#ifdef TSCH_CALLBACK_OVERHEARD
+int TSCH_CALLBACK_OVERHEARD(void);
+#endif
+
 /* Called by TSCH every time a packet is ready to be added to the send queue */
 #ifdef TSCH_CALLBACK_PACKET_READY
 int TSCH_CALLBACK_PACKET_READY(void);
@@ -70,6 +70,20 @@ static unsigned num_tables;
 MEMB(neighbor_addr_mem, nbr_table_key_t, NBR_TABLE_MAX_NEIGHBORS);
 LIST(nbr_table_keys);
 
+#if NBR_TABLE_WITH_LLADDR_INDEX
+#if NBR_TABLE_LLADDR_INDEX_SIZE <= NBR_TABLE_MAX_NEIGHBORS
+#error NBR_TABLE_LLADDR_INDEX_SIZE must be larger than NBR_TABLE_MAX_NEIGHBORS
+#endif
+#if NBR_TABLE_MAX_NEIGHBORS < 255
+typedef uint8_t lladdr_index_entry_t;
+#else
+typedef uint16_t lladdr_index_entry_t;
+#endif
+/* Hash index from link-layer addresses to neighbor indexes, with linear
+ * probing. Each slot holds a neighbor index plus one, or 0 when empty */
+static lladdr_index_entry_t lladdr_index[NBR_TABLE_LLADDR_INDEX_SIZE];
+#endif /* NBR_TABLE_WITH_LLADDR_INDEX */
+
 /*---------------------------------------------------------------------------*/
 static void remove_key(nbr_table_key_t *key, bool do_free);
 /*---------------------------------------------------------------------------*/
@@ -115,16 +129,84 @@ key_from_item(const nbr_table_t *table, const nbr_table_item_t *item)
   return key_from_index(index_from_item(table, item));
 }
 /*---------------------------------------------------------------------------*/
+#if NBR_TABLE_WITH_LLADDR_INDEX
+/* Get the home slot of a link-layer address in the index */
+static int
+lladdr_index_slot(const linkaddr_t *lladdr)
+{
+  unsigned hash = 0;
+  int i;
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    hash = hash * 31 + lladdr->u8[i];
+  }
+  return hash % NBR_TABLE_LLADDR_INDEX_SIZE;
+}
+/*---------------------------------------------------------------------------*/
+/* Add a neighbor to the link-layer address index */
+static void
+lladdr_index_add(const nbr_table_key_t *key)
+{
+  int slot = lladdr_index_slot(&key->lladdr);
+  while(lladdr_index[slot] != 0) {
+    slot = (slot + 1) % NBR_TABLE_LLADDR_INDEX_SIZE;
+  }
+  lladdr_index[slot] = index_from_key(key) + 1;
+}
+/*---------------------------------------------------------------------------*/
+/* Remove a neighbor from the link-layer address index */
+static void
+lladdr_index_remove(const nbr_table_key_t *key)
+{
+  int hole = lladdr_index_slot(&key->lladdr);
+  int slot;
+  int home;
+
+  while(lladdr_index[hole] != index_from_key(key) + 1) {
+    if(lladdr_index[hole] == 0) {
+      return;
+    }
+    hole = (hole + 1) % NBR_TABLE_LLADDR_INDEX_SIZE;
+  }
+
+  /* Move back the following neighbors of the probe sequence that may fill
+   * the hole, so that lookups never stop before reaching them */
+  slot = (hole + 1) % NBR_TABLE_LLADDR_INDEX_SIZE;
+  while(lladdr_index[slot] != 0) {
+    home = lladdr_index_slot(&key_from_index(lladdr_index[slot] - 1)->lladdr);
+    if(hole < slot ? home <= hole || home > slot
+                   : home <= hole && home > slot) {
+      lladdr_index[hole] = lladdr_index[slot];
+      hole = slot;
+    }
+    slot = (slot + 1) % NBR_TABLE_LLADDR_INDEX_SIZE;
+  }
+  lladdr_index[hole] = 0;
+}
+#endif /* NBR_TABLE_WITH_LLADDR_INDEX */
+/*---------------------------------------------------------------------------*/
 /* Get the index of a neighbor from its link-layer address */
 static int
 index_from_lladdr(const linkaddr_t *lladdr)
 {
+#if NBR_TABLE_WITH_LLADDR_INDEX
+  int slot;
+#else /* NBR_TABLE_WITH_LLADDR_INDEX */
   nbr_table_key_t *key;
+#endif /* NBR_TABLE_WITH_LLADDR_INDEX */
   /* Allow lladdr-free insertion, useful e.g. for IPv6 ND.
    * Only one such entry is possible at a time, indexed by linkaddr_null. */
   if(lladdr == NULL) {
     lladdr = &linkaddr_null;
   }
+#if NBR_TABLE_WITH_LLADDR_INDEX
+  slot = lladdr_index_slot(lladdr);
+  while(lladdr_index[slot] != 0) {
+    if(linkaddr_cmp(lladdr, &key_from_index(lladdr_index[slot] - 1)->lladdr)) {
+      return lladdr_index[slot] - 1;
+    }
+    slot = (slot + 1) % NBR_TABLE_LLADDR_INDEX_SIZE;
+  }
+#else /* NBR_TABLE_WITH_LLADDR_INDEX */
   key = list_head(nbr_table_keys);
   while(key != NULL) {
     if(lladdr && linkaddr_cmp(lladdr, &key->lladdr)) {
@@ -132,6 +214,7 @@ index_from_lladdr(const linkaddr_t *lladdr)
     }
     key = list_item_next(key);
   }
+#endif /* NBR_TABLE_WITH_LLADDR_INDEX */
   return -1;
 }
 /*---------------------------------------------------------------------------*/
@@ -183,6 +266,9 @@ remove_key(nbr_table_key_t *key, bool do_free)
   locked_map[index_from_key(key)] = 0;
   /* Remove neighbor from list */
   list_remove(nbr_table_keys, key);
+#if NBR_TABLE_WITH_LLADDR_INDEX
+  lladdr_index_remove(key);
+#endif /* NBR_TABLE_WITH_LLADDR_INDEX */
   if(do_free) {
     /* Release the memory */
     memb_free(&neighbor_addr_mem, key);
@@ -430,6 +516,9 @@ nbr_table_add_lladdr(const nbr_table_t *table, const linkaddr_t *lladdr,
 
     /* Set link-layer address */
     linkaddr_copy(&key->lladdr, lladdr);
+#if NBR_TABLE_WITH_LLADDR_INDEX
+    lladdr_index_add(key);
+#endif /* NBR_TABLE_WITH_LLADDR_INDEX */
   }
 
   /* Get item in the current table */
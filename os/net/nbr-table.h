@@ -55,6 +55,23 @@ typedef enum {
 
 #define NBR_TABLE_MAX_NEIGHBORS NBR_TABLE_CONF_MAX_NEIGHBORS
 
+/* Whether neighbors are found from their link-layer address through a hash
+ * index, at the cost of NBR_TABLE_LLADDR_INDEX_SIZE bytes (two bytes each
+ * from 255 neighbors on), instead of a walk over every neighbor */
+#ifdef NBR_TABLE_CONF_WITH_LLADDR_INDEX
+#define NBR_TABLE_WITH_LLADDR_INDEX NBR_TABLE_CONF_WITH_LLADDR_INDEX
+#else /* NBR_TABLE_CONF_WITH_LLADDR_INDEX */
+#define NBR_TABLE_WITH_LLADDR_INDEX 1
+#endif /* NBR_TABLE_CONF_WITH_LLADDR_INDEX */
+
+/* The number of slots of the link-layer address index. It must exceed
+ * NBR_TABLE_MAX_NEIGHBORS, and twice as many keep the probes short */
+#ifdef NBR_TABLE_CONF_LLADDR_INDEX_SIZE
+#define NBR_TABLE_LLADDR_INDEX_SIZE NBR_TABLE_CONF_LLADDR_INDEX_SIZE
+#else /* NBR_TABLE_CONF_LLADDR_INDEX_SIZE */
+#define NBR_TABLE_LLADDR_INDEX_SIZE (2 * NBR_TABLE_MAX_NEIGHBORS)
+#endif /* NBR_TABLE_CONF_LLADDR_INDEX_SIZE */
+
 #ifdef NBR_TABLE_CONF_GC_GET_WORST
 #define NBR_TABLE_GC_GET_WORST NBR_TABLE_CONF_GC_GET_WORST
 #else /* NBR_TABLE_CONF_GC_GET_WORST */
@@ -43,8 +43,6 @@
  *         Simon Duquennoy <simon.duquennoy@inria.fr>
  */
 
-#include "examples/vinicius/netcoding/netcoding.h"
-#include "examples/vinicius/netcoding/utils.h"
 #include "net/ipv6/uip-sr.h"
 #include "net/packetbuf.h"
 #include "net/routing/routing.h"
@@ -55,75 +53,6 @@
 #define LOG_MODULE "RPL"
 #define LOG_LEVEL LOG_LEVEL_RPL
 
-netcoding_node network_coding_node;
-
-void drop_packet() {
-  uipbuf_clear();
-  uip_flags = 0;
-}
-/*----------------------------------------------------------------------------*/
-/**
- * @brief Function that receives a certain packet and call the network coding
- * code in order to combine packets. If the packet is not combined, then the
- * node interrupts the packet routing process and store it locally.
- *
- * @param data The pointer to the packet first byte in the UDP buffer.
- */
-void MAC_route_packet(char *data) {
-  netcoding_packet *packet =
-      (netcoding_packet *)malloc(sizeof(netcoding_packet));
-  memcpy(packet, data, PACKET_SIZE);
-
-  print_packet(packet);
-  printf("\n");
-
-  netcoding_packet *packet_to_route =
-      encode_packet(&network_coding_node, packet);
-
-  // Interrupts the routing process
-  if (packet_to_route == NULL) {
-    drop_packet();
-  } else {
-    memcpy(data, packet_to_route, PACKET_SIZE);
-    free(packet_to_route);
-  }
-}
-/*----------------------------------------------------------------------------*/
-/**
- * @brief Function that deals with network coding in the NETWORK layer.
- *
- */
-void MAC_network_coding_intervention() {
-  struct uip_routing_hdr *rh_header =
-      (struct uip_routing_hdr *)uipbuf_search_header(uip_buf, uip_len,
-                                                     UIP_PROTO_ROUTING);
-  uint64_t has_preamble, offset;
-  char *header_type;
-
-  // If the header has a variable size
-  if (!(rh_header == NULL || rh_header->routing_type != RPL_RH_TYPE_SRH)) {
-    uint8_t ext_len = rh_header->len * 8 + 8;
-    // If it's a valid network coding packet
-    has_preamble = HAS_PREAMBLE((char *)&uip_buf[UIP_IPUDPH_LEN + ext_len]);
-    header_type = "VAR   ";
-    offset = 8 + ext_len;
-  }
-  // Fixed size header
-  else {
-    // If it's a valid network coding packet
-    has_preamble = HAS_PREAMBLE((char *)&uip_buf[UIP_IPUDPH_LEN + 8]);
-    header_type = "CONST ";
-    offset = 16;
-  }
-
-  // If it's a valid network coding packet
-  if (has_preamble) {
-    netcoding_log_format(header_type, network_coding_node.id, has_preamble,
-                         &UIP_IP_BUF->srcipaddr);
-    MAC_route_packet((char *)UIP_IP_PAYLOAD(offset));
-  }
-}
-/*---------------------------------------------------------------------------*/
 int rpl_ext_header_srh_get_next_hop(uip_ipaddr_t *ipaddr) {
   struct uip_routing_hdr *rh_header;
   uip_sr_node_t *dest_node;
@@ -233,17 +162,6 @@ int rpl_ext_header_srh_update(void) {
   return 1;
 }
 /*---------------------------------------------------------------------------*/
-/* Utility function for SRH. Counts the number of bytes in common between
- * two addresses at p1 and p2. */
-static int count_matching_bytes(const void *p1, const void *p2, size_t n) {
-  for (size_t i = 0; i < n; i++) {
-    if (((uint8_t *)p1)[i] != ((uint8_t *)p2)[i]) {
-      return i;
-    }
-  }
-  return n;
-}
-/*---------------------------------------------------------------------------*/
 /* Used by rpl_ext_header_update to insert a RPL SRH extension header. This
  * is used at the root, to initiate downward routing. Returns 1 on success,
  * 0 on failure.
@@ -294,38 +212,17 @@ static int insert_srh_header(void) {
     return 0;
   }
 
-  if (!uip_sr_is_addr_reachable(NULL, &UIP_IP_BUF->destipaddr)) {
+  /* Get path length and compression factors (we use cmpri == cmpre) */
+  if (!uip_sr_get_path(root_node, dest_node, &path_len, &cmpri)) {
     LOG_ERR("SRH no path found to destination\n");
     return 0;
   }
-
-  /* Compute path length and compression factors (we use cmpri == cmpre) */
-  path_len = 0;
-  node = dest_node->parent;
-  /* For simplicity, we use cmpri = cmpre */
-  cmpri = 15;
-  cmpre = 15;
+  cmpre = cmpri;
 
   /* Note that in case of a direct child (node == root_node), we insert
   SRH anyway, as RFC 6553 mandates that routed datagrams must include
   SRH or the RPL option (or both) */
 
-  while (node != NULL && node != root_node) {
-
-    NETSTACK_ROUTING.get_sr_node_ipaddr(&node_addr, node);
-
-    /* How many bytes in common between all nodes in the path? */
-    cmpri = MIN(cmpri,
-                count_matching_bytes(&node_addr, &UIP_IP_BUF->destipaddr, 16));
-    cmpre = cmpri;
-
-    LOG_INFO("SRH Hop ");
-    LOG_INFO_6ADDR(&node_addr);
-    LOG_INFO_("\n");
-    node = node->parent;
-    path_len++;
-  }
-
   /* Extension header length: fixed headers + (n-1) * (16-ComprI) +
    * (16-ComprE)*/
   ext_len =
@@ -373,6 +270,10 @@ static int insert_srh_header(void) {
   while (node != NULL && node->parent != root_node) {
     NETSTACK_ROUTING.get_sr_node_ipaddr(&node_addr, node);
 
+    LOG_INFO("SRH Hop ");
+    LOG_INFO_6ADDR(&node_addr);
+    LOG_INFO_("\n");
+
     hop_ptr -= (16 - cmpri);
     memcpy(hop_ptr, ((uint8_t *)&node_addr) + cmpri, 16 - cmpri);
 
@@ -454,8 +355,6 @@ static int update_hbh_header(void) {
   struct uip_ext_hdr_opt_rpl *rpl_opt =
       (struct uip_ext_hdr_opt_rpl *)(UIP_IP_PAYLOAD(2));
 
-  MAC_network_coding_intervention();
-
   if (UIP_IP_BUF->proto == UIP_PROTO_HBHO &&
       rpl_opt->opt_type == UIP_EXT_HDR_OPT_RPL) {
     if (hbh_hdr->len != ((RPL_HOP_BY_HOP_LEN - 8) / 8) ||
@@ -49,11 +49,123 @@
 #include "sys/etimer.h"
 #include "sys/process.h"
 
+#if ETIMER_HEAP_SIZE > 0xffff
+#error ETIMER_CONF_HEAP_SIZE must fit the heap_index of struct etimer
+#endif
+
+/* The pending timers that are not in the heap */
 static struct etimer *timerlist;
 static clock_time_t next_expiration;
 
+#if ETIMER_HEAP_SIZE
+/* The pending timers as a binary heap: the children 2i+1 and 2i+2 of
+   the timer at index i expire no earlier than it does. */
+static struct etimer *heap[ETIMER_HEAP_SIZE];
+static uint16_t heap_size;
+#endif
+
 PROCESS(etimer_process, "Event timer");
 /*---------------------------------------------------------------------------*/
+#if ETIMER_HEAP_SIZE
+static bool
+expires_before(const struct etimer *a, const struct etimer *b)
+{
+  /* The difference is negative, i.e. over half the range once unsigned,
+     when a expires first; this holds across clock wraps. */
+  return (clock_time_t)(a->timer.start + a->timer.interval -
+                        b->timer.start - b->timer.interval) >
+         (clock_time_t)~(clock_time_t)0 / 2;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_place(struct etimer *t, uint16_t i)
+{
+  heap[i] = t;
+  t->heap_index = i;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_sift_up(uint16_t i)
+{
+  struct etimer *t = heap[i];
+
+  while(i > 0 && expires_before(t, heap[(i - 1) / 2])) {
+    heap_place(heap[(i - 1) / 2], i);
+    i = (i - 1) / 2;
+  }
+  heap_place(t, i);
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_sift_down(uint16_t i)
+{
+  struct etimer *t = heap[i];
+  uint16_t child;
+
+  while((child = 2 * i + 1) < heap_size) {
+    if(child + 1 < heap_size && expires_before(heap[child + 1], heap[child])) {
+      child++;
+    }
+    if(!expires_before(heap[child], t)) {
+      break;
+    }
+    heap_place(heap[child], i);
+    i = child;
+  }
+  heap_place(t, i);
+}
+/*---------------------------------------------------------------------------*/
+/* Restores the heap order once the expiration time of the timer at index
+   i changed. */
+static void
+heap_update(uint16_t i)
+{
+  struct etimer *t = heap[i];
+
+  heap_sift_up(i);
+  if(t->heap_index == i) {
+    heap_sift_down(i);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static bool
+heap_contains(const struct etimer *t)
+{
+  /* The index of a timer that is not in the heap may be anything. */
+  return t->heap_index < heap_size && heap[t->heap_index] == t;
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_remove(uint16_t i)
+{
+  heap_size--;
+  if(i < heap_size) {
+    heap_place(heap[heap_size], i);
+    heap_update(i);
+  }
+}
+/*---------------------------------------------------------------------------*/
+static void
+heap_remove_process(struct process *p)
+{
+  uint16_t i;
+  uint16_t n;
+
+  /* Keep the timers of the other processes and heapify them again */
+  for(i = n = 0; i < heap_size; i++) {
+    if(heap[i]->p != p) {
+      heap_place(heap[i], n++);
+    }
+  }
+  if(n < heap_size) {
+    heap_size = n;
+    for(i = n / 2; i > 0; i--) {
+      heap_sift_down(i - 1);
+    }
+  }
+}
+#endif /* ETIMER_HEAP_SIZE */
+/*---------------------------------------------------------------------------*/
 static void
 update_time(void)
 {
@@ -61,14 +173,18 @@ update_time(void)
   clock_time_t now;
   struct etimer *t;
 
-  if(timerlist == NULL) {
+#if ETIMER_HEAP_SIZE
+  t = heap_size > 0 ? heap[0] : timerlist;
+#else
+  t = timerlist;
+#endif
+  if(t == NULL) {
     next_expiration = 0;
   } else {
     now = clock_time();
-    t = timerlist;
     /* Must calculate distance to next time into account due to wraps */
     tdist = t->timer.start + t->timer.interval - now;
-    for(t = t->next; t != NULL; t = t->next) {
+    for(t = timerlist; t != NULL; t = t->next) {
       if(t->timer.start + t->timer.interval - now < tdist) {
         tdist = t->timer.start + t->timer.interval - now;
       }
@@ -84,6 +200,9 @@ PROCESS_THREAD(etimer_process, ev, data)
   PROCESS_BEGIN();
 
   timerlist = NULL;
+#if ETIMER_HEAP_SIZE
+  heap_size = 0;
+#endif
 
   while(1) {
     PROCESS_YIELD();
@@ -91,6 +210,9 @@ PROCESS_THREAD(etimer_process, ev, data)
     if(ev == PROCESS_EVENT_EXITED) {
       struct process *p = data;
 
+#if ETIMER_HEAP_SIZE
+      heap_remove_process(p);
+#endif
       while(timerlist != NULL && timerlist->p == p) {
         timerlist = timerlist->next;
       }
@@ -110,6 +232,20 @@ PROCESS_THREAD(etimer_process, ev, data)
       continue;
     }
 
+#if ETIMER_HEAP_SIZE
+    /* The heap pops the expired timers first to last */
+    while(heap_size > 0 && timer_expired(&heap[0]->timer)) {
+      t = heap[0];
+      if(process_post(t->p, PROCESS_EVENT_TIMER, t) != PROCESS_ERR_OK) {
+        etimer_request_poll();
+        break;
+      }
+      t->p = PROCESS_NONE;
+      heap_remove(0);
+      update_time();
+    }
+#endif
+
 again:
 
     u = NULL;
@@ -155,6 +291,15 @@ add_timer(struct etimer *timer)
   etimer_request_poll();
 
   if(timer->p != PROCESS_NONE) {
+#if ETIMER_HEAP_SIZE
+    if(heap_contains(timer)) {
+      /* Timer already in the heap, move it to its new place. */
+      timer->p = PROCESS_CURRENT();
+      heap_update(timer->heap_index);
+      update_time();
+      return;
+    }
+#endif
     for(t = timerlist; t != NULL; t = t->next) {
       if(t == timer) {
         /* Timer already on list, bail out. */
@@ -167,6 +312,14 @@ add_timer(struct etimer *timer)
 
   /* Timer not on list. */
   timer->p = PROCESS_CURRENT();
+#if ETIMER_HEAP_SIZE
+  if(heap_size < ETIMER_HEAP_SIZE) {
+    heap_place(timer, heap_size++);
+    heap_sift_up(timer->heap_index);
+    update_time();
+    return;
+  }
+#endif
   timer->next = timerlist;
   timerlist = timer;
 
@@ -206,6 +359,11 @@ void
 etimer_adjust(struct etimer *et, int timediff)
 {
   et->timer.start += timediff;
+#if ETIMER_HEAP_SIZE
+  if(heap_contains(et)) {
+    heap_update(et->heap_index);
+  }
+#endif
   update_time();
 }
 /*---------------------------------------------------------------------------*/
@@ -224,6 +382,11 @@ etimer_start_time(struct etimer *et)
 int
 etimer_pending(void)
 {
+#if ETIMER_HEAP_SIZE
+  if(heap_size > 0) {
+    return 1;
+  }
+#endif
   return timerlist != NULL;
 }
 /*---------------------------------------------------------------------------*/
@@ -238,6 +401,12 @@ etimer_stop(struct etimer *et)
 {
   struct etimer *t;
 
+#if ETIMER_HEAP_SIZE
+  if(heap_contains(et)) {
+    heap_remove(et->heap_index);
+    update_time();
+  } else
+#endif
   /* First check if et is the first event timer on the list. */
   if(et == timerlist) {
     timerlist = timerlist->next;
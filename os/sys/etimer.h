@@ -68,6 +68,20 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+/**
+ * The number of pending event timers kept in a binary heap ordered by
+ * expiration time, which makes setting, stopping and expiring a timer
+ * O(log N) and finding the next expiration O(1), instead of walking a
+ * list of every pending timer. The timers beyond it, and all of them
+ * when it is 0, are kept in an unsorted list. The heap orders timers
+ * expiring less than half the clock range apart.
+ */
+#ifdef ETIMER_CONF_HEAP_SIZE
+#define ETIMER_HEAP_SIZE ETIMER_CONF_HEAP_SIZE
+#else
+#define ETIMER_HEAP_SIZE 0
+#endif
+
 /**
  * A timer.
  *
@@ -80,6 +94,9 @@ struct etimer {
   struct timer timer;
   struct etimer *next;
   struct process *p;
+#if ETIMER_HEAP_SIZE
+  uint16_t heap_index;
+#endif
 };
 
 /**
@@ -36,6 +36,7 @@
 #include "lib/circular-list.h"
 #include "lib/dbl-list.h"
 #include "lib/dbl-circ-list.h"
+#include "lib/memb.h"
 #include "lib/random.h"
 #include "services/unit-test/unit-test.h"
 
@@ -1024,6 +1025,60 @@ UNIT_TEST(test_cdll)
   UNIT_TEST_END();
 }
 /*---------------------------------------------------------------------------*/
+#define MEMB_BLOCK_COUNT 40
+MEMB(test_memb, demo_struct_t, MEMB_BLOCK_COUNT);
+/*---------------------------------------------------------------------------*/
+UNIT_TEST_REGISTER(test_memb, "Memory block allocation");
+UNIT_TEST(test_memb)
+{
+  demo_struct_t *blocks[MEMB_BLOCK_COUNT];
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  memb_init(&test_memb);
+
+  /* Starts from empty */
+  UNIT_TEST_ASSERT(memb_numfree(&test_memb) == MEMB_BLOCK_COUNT);
+  UNIT_TEST_ASSERT(memb_high_water(&test_memb) == 0);
+
+  /* Blocks are handed out in order, across bitmap words, until none is left */
+  for(i = 0; i < MEMB_BLOCK_COUNT; i++) {
+    blocks[i] = memb_alloc(&test_memb);
+    UNIT_TEST_ASSERT(blocks[i] == (demo_struct_t *)test_memb.mem + i);
+    UNIT_TEST_ASSERT(memb_inmemb(&test_memb, blocks[i]));
+  }
+  UNIT_TEST_ASSERT(memb_alloc(&test_memb) == NULL);
+  UNIT_TEST_ASSERT(memb_numfree(&test_memb) == 0);
+
+  /* A freed block is the next one allocated */
+  UNIT_TEST_ASSERT(memb_free(&test_memb, blocks[33]) == 0);
+  UNIT_TEST_ASSERT(memb_free(&test_memb, blocks[2]) == 0);
+  UNIT_TEST_ASSERT(memb_numfree(&test_memb) == 2);
+  UNIT_TEST_ASSERT(memb_alloc(&test_memb) == blocks[2]);
+  UNIT_TEST_ASSERT(memb_alloc(&test_memb) == blocks[33]);
+
+  /* Double frees and pointers to no block are rejected */
+  UNIT_TEST_ASSERT(memb_free(&test_memb, blocks[5]) == 0);
+  UNIT_TEST_ASSERT(memb_free(&test_memb, blocks[5]) == -1);
+  UNIT_TEST_ASSERT(memb_free(&test_memb, (char *)blocks[6] + 1) == -1);
+  UNIT_TEST_ASSERT(memb_free(&test_memb, &elements[0]) == -1);
+  UNIT_TEST_ASSERT(memb_numfree(&test_memb) == 1);
+
+  /* The high-water mark stays at the peak */
+  for(i = 0; i < MEMB_BLOCK_COUNT; i++) {
+    memb_free(&test_memb, blocks[i]);
+  }
+  UNIT_TEST_ASSERT(memb_numfree(&test_memb) == MEMB_BLOCK_COUNT);
+  UNIT_TEST_ASSERT(memb_high_water(&test_memb) == MEMB_BLOCK_COUNT);
+
+  /* Ends reset */
+  memb_init(&test_memb);
+  UNIT_TEST_ASSERT(memb_high_water(&test_memb) == 0);
+
+  UNIT_TEST_END();
+}
+/*---------------------------------------------------------------------------*/
 PROCESS_THREAD(data_structure_test_process, ev, data)
 {
   PROCESS_BEGIN();
@@ -1039,6 +1094,7 @@ PROCESS_THREAD(data_structure_test_process, ev, data)
   UNIT_TEST_RUN(test_csll);
   UNIT_TEST_RUN(test_dll);
   UNIT_TEST_RUN(test_cdll);
+  UNIT_TEST_RUN(test_memb);
 
   printf("=check-me= DONE\n");
 
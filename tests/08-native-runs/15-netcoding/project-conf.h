@@ -0,0 +1,8 @@
+#ifndef PROJECT_CONF_H
+#define PROJECT_CONF_H
+
+/* The network coding is expected to run from static pools, so any heap
+   usage shows up in the reported peak footprint. */
+#define HEAPMEM_CONF_ARENA_SIZE 4096
+
+#endif /* !PROJECT_CONF_H */
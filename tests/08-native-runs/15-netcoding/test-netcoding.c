@@ -0,0 +1,689 @@
+/*
+ * \file
+ *      Benchmark of the network coding kernels of examples/vinicius/netcoding.
+ *
+ *      A router codes the synthetic traffic of two flows crossing it, Alice
+ *      sending the even packet ids and Bob the odd ones, and Bob decodes what
+ *      the router sends him through a lossy link, knowing his own packets.
+ *      The window, payload size, number of combinations and coding mode are
+ *      the usual NETCODING_CONF_* parameters, e.g.
+ *      make DEFINES=NETCODING_CONF_PAYLOAD_SIZE=512,BENCH_CONF_LOSS_RATE=20
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "lib/heapmem.h"
+#include "lib/random.h"
+#include "unit-test/unit-test.h"
+
+#include "netcoding.h"
+#include "hash_table.h"
+/*****************************************************************************/
+/* Number of native packets sent through the router. */
+#ifdef BENCH_CONF_PACKETS
+#define BENCH_PACKETS BENCH_CONF_PACKETS
+#else
+#define BENCH_PACKETS 20000
+#endif
+
+/* Percentage of the router transmissions lost on the way to Bob. */
+#ifdef BENCH_CONF_LOSS_RATE
+#define BENCH_LOSS_RATE BENCH_CONF_LOSS_RATE
+#else
+#define BENCH_LOSS_RATE 10
+#endif
+
+/* Number of iterations of the XOR and header set micro-benchmarks. */
+#ifdef BENCH_CONF_ITERATIONS
+#define BENCH_ITERATIONS BENCH_CONF_ITERATIONS
+#else
+#define BENCH_ITERATIONS 100000
+#endif
+
+/* Number of headers held at once by the header set micro-benchmark. */
+#define HEADER_SET_SIZE (HEADER_SET_MAX_LOAD & ~1)
+/*****************************************************************************/
+PROCESS(test_netcoding_process, "Network coding benchmark");
+AUTOSTART_PROCESSES(&test_netcoding_process);
+
+/* The router encoding and Bob decoding share the node, since they use
+   disjoint parts of it. */
+netcoding_node network_coding_node;
+
+static uint32_t decode_ns[BENCH_PACKETS];
+static unsigned num_decodes;
+static uint8_t is_delivered[BENCH_PACKETS];
+static unsigned delivered;
+static unsigned corrupted;
+/*****************************************************************************/
+static uint64_t
+now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+static uint8_t
+body_byte(uint32_t packet_id, int i)
+{
+  return (uint8_t)(packet_id * 31 + i);
+}
+/*****************************************************************************/
+static netcoding_packet
+create_bench_packet(uint32_t packet_id)
+{
+  netcoding_packet packet = create_packet(packet_id, "");
+  int i;
+
+  for(i = 0; i < PAYLOAD_SIZE; i++) {
+    packet.body[i] = body_byte(packet_id, i);
+  }
+  return packet;
+}
+/*****************************************************************************/
+static int
+compare_ns(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+
+  return (x > y) - (x < y);
+}
+/*****************************************************************************/
+static struct linked_list_t *
+decode(netcoding_packet *packet)
+{
+  struct linked_list_t *decoded;
+  linked_list_node *cur_node;
+
+  decoded = decode_packets(&network_coding_node, packet);
+  for(cur_node = decoded->head; cur_node != NULL; cur_node = cur_node->next) {
+    netcoding_packet *native = (netcoding_packet *)cur_node->data;
+    uint32_t packet_id = native->header.holding_packets[0];
+    int i;
+
+    /* Bob's own packets are known already */
+    if(packet_id % 2 || packet_id >= BENCH_PACKETS ||
+       is_delivered[packet_id]) {
+      continue;
+    }
+    is_delivered[packet_id] = 1;
+    delivered++;
+    for(i = 0; i < PAYLOAD_SIZE; i++) {
+      if((uint8_t)native->body[i] != body_byte(packet_id, i)) {
+        corrupted++;
+        break;
+      }
+    }
+  }
+  return decoded;
+}
+/*****************************************************************************/
+/* A transmission of the router, either routed right away or flushed. */
+static void
+transmit(netcoding_packet *packet, netcoding_route *route)
+{
+  uint64_t start;
+
+  if(random_rand() % 100 < BENCH_LOSS_RATE) {
+    return;
+  }
+  start = now_ns();
+  clear_list(decode(packet));
+  if(num_decodes < BENCH_PACKETS) {
+    decode_ns[num_decodes++] = now_ns() - start;
+  }
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(coding, "Encode and decode");
+UNIT_TEST(coding)
+{
+  netcoding_node *node = &network_coding_node;
+  uint64_t encode_ns = 0;
+  uint64_t start;
+  heapmem_stats_t stats;
+  uint32_t packet_id;
+
+  UNIT_TEST_BEGIN();
+
+  create_netcoding_combinatory_routing_node(1);
+  node->prob_to_combine = 100;
+  node->transmit = transmit;
+  seed_netcoding_node(node, 1);
+  random_init(1);
+
+  for(packet_id = 0; packet_id < BENCH_PACKETS; packet_id++) {
+    netcoding_packet packet = create_bench_packet(packet_id);
+
+    if(packet_id % 2) {
+      clear_list(decode(&packet));
+    }
+
+    start = now_ns();
+    if(encode_packet(node, &packet, NULL)) {
+      encode_ns += now_ns() - start;
+      transmit(&packet, NULL);
+    } else {
+      encode_ns += now_ns() - start;
+    }
+  }
+
+  /* Flush the packets still withheld, as their hold timer would */
+  while(node->combination_buffer.head != NULL) {
+    flush_packet(node, &node->combination_buffer,
+                 (netcoding_slot *)node->combination_buffer.head);
+  }
+  while(node->raw_buffer.head != NULL) {
+    flush_packet(node, &node->raw_buffer,
+                 (netcoding_slot *)node->raw_buffer.head);
+  }
+  ctimer_stop(&node->hold_timer);
+
+  qsort(decode_ns, num_decodes, sizeof(decode_ns[0]), compare_ns);
+  heapmem_stats(&stats);
+
+  printf("window %d, payload %d, combinations %d, mode %d, loss %d%%\n",
+         NETCODING_WINDOW_SIZE, PAYLOAD_SIZE, NUM_COMBINATIONS,
+         (int)node->mode, BENCH_LOSS_RATE);
+  printf("encode: %u packets, %.1f ns/packet, %.0f packets/s\n",
+         BENCH_PACKETS, (double)encode_ns / BENCH_PACKETS,
+         encode_ns ? BENCH_PACKETS * 1e9 / encode_ns : 0.0);
+  if(num_decodes > 0) {
+    printf("decode: %u packets, p50 %u ns, p90 %u ns, p99 %u ns, max %u ns\n",
+           num_decodes, (unsigned)decode_ns[num_decodes / 2],
+           (unsigned)decode_ns[num_decodes * 9 / 10],
+           (unsigned)decode_ns[num_decodes * 99 / 100],
+           (unsigned)decode_ns[num_decodes - 1]);
+  }
+  printf("delivered %u of %u, corrupted %u\n",
+         delivered, BENCH_PACKETS / 2, corrupted);
+  printf("heap peak %zu bytes, node %zu bytes\n",
+         stats.max_footprint, sizeof(netcoding_node));
+  print_stats(&node->stats);
+
+  UNIT_TEST_ASSERT(corrupted == 0);
+  UNIT_TEST_ASSERT(BENCH_LOSS_RATE >= 100 || delivered > 0);
+  /* Bob's own packets are counted as decoded too */
+  UNIT_TEST_ASSERT(node->stats.counters[NETCODING_EVENT_DECODED] >= delivered);
+  /* Every flushed packet was stored first */
+  UNIT_TEST_ASSERT(node->stats.counters[NETCODING_EVENT_FLUSHED] <=
+                   node->stats.counters[NETCODING_EVENT_STORED]);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(xor, "XOR kernel");
+UNIT_TEST(xor)
+{
+  static netcoding_packet packets[2];
+  uint64_t start, elapsed;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  packets[0] = create_bench_packet(0);
+  packets[1] = create_bench_packet(1);
+
+  start = now_ns();
+  for(i = 0; i < BENCH_ITERATIONS; i++) {
+    xor_combine(packets[0].body, packets[1].body, packets[0].body);
+  }
+  elapsed = now_ns() - start;
+
+  printf("xor_combine: %d bytes, %.1f ns/op, %.0f MB/s\n", PAYLOAD_SIZE,
+         (double)elapsed / BENCH_ITERATIONS,
+         elapsed ? (double)PAYLOAD_SIZE * BENCH_ITERATIONS * 1e3 / elapsed
+                 : 0.0);
+
+  /* An even number of combinations gives the packet back */
+  UNIT_TEST_ASSERT(BENCH_ITERATIONS % 2 ||
+                   memcmp(packets[0].body, create_bench_packet(0).body,
+                          PAYLOAD_SIZE) == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(hash, "Header set");
+UNIT_TEST(hash)
+{
+  static header_set set;
+  netcoding_packet_header header;
+  uint64_t start, elapsed;
+  unsigned found = 0;
+  unsigned removed = 0;
+  uint32_t i, j;
+
+  UNIT_TEST_BEGIN();
+
+  init_header_set(&set);
+  memset(&header, 0, sizeof(header));
+  memset(header.holding_packets, 0xFF, sizeof(header.holding_packets));
+
+  /* Packet 0 is a key like any other one */
+  header.holding_packets[0] = 0;
+  header.coefficients[0] = 1;
+  UNIT_TEST_ASSERT(insert_header(&set, &header) == 1);
+  UNIT_TEST_ASSERT(insert_header(&set, &header) == 2);
+  UNIT_TEST_ASSERT(remove_header(&set, &header) == 1);
+  UNIT_TEST_ASSERT(!has_header(&set, &header));
+
+#if NUM_COMBINATIONS > 1
+  /* Combinations with the same id sum are distinct keys */
+  header.holding_packets[0] = 1;
+  header.holding_packets[1] = 2;
+  header.coefficients[1] = 1;
+  UNIT_TEST_ASSERT(insert_header(&set, &header) == 1);
+  header.holding_packets[0] = 0;
+  header.holding_packets[1] = 3;
+  UNIT_TEST_ASSERT(!has_header(&set, &header));
+  init_header_set(&set);
+  header.holding_packets[1] = EMPTY_PACKET_ID;
+  header.coefficients[1] = 0;
+#endif
+
+  start = now_ns();
+  for(i = 0; i < BENCH_ITERATIONS / HEADER_SET_SIZE; i++) {
+    for(j = 0; j < HEADER_SET_SIZE; j++) {
+      header.holding_packets[0] = i * HEADER_SET_SIZE + j;
+      insert_header(&set, &header);
+    }
+    for(j = 0; j < HEADER_SET_SIZE; j++) {
+      header.holding_packets[0] = i * HEADER_SET_SIZE + j;
+      found += has_header(&set, &header);
+    }
+    /* Removing every other header leaves tombstones to probe through */
+    for(j = 0; j < HEADER_SET_SIZE; j += 2) {
+      header.holding_packets[0] = i * HEADER_SET_SIZE + j;
+      removed += remove_header(&set, &header);
+    }
+    for(j = 1; j < HEADER_SET_SIZE; j += 2) {
+      header.holding_packets[0] = i * HEADER_SET_SIZE + j;
+      found += has_header(&set, &header);
+      removed += remove_header(&set, &header);
+    }
+  }
+  elapsed = now_ns() - start;
+
+  printf("header_set: %u lookups, %u removals, %.1f ns/op\n", found, removed,
+         found ? (double)elapsed / (2 * found + removed) : 0.0);
+
+  UNIT_TEST_ASSERT(found == BENCH_ITERATIONS / HEADER_SET_SIZE *
+                   (HEADER_SET_SIZE + HEADER_SET_SIZE / 2));
+  UNIT_TEST_ASSERT(removed == BENCH_ITERATIONS / HEADER_SET_SIZE *
+                   HEADER_SET_SIZE);
+  UNIT_TEST_ASSERT(set.size == 0 && set.tombstones == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+/* Writes a packet whose ids are deltas from the start of their generation,
+   whatever they are, as a faulty or hostile neighbor could. */
+static int
+pack_deltas(uint8_t *data, uint32_t generation, const uint32_t *deltas,
+            int num_deltas)
+{
+  uint8_t *cur = data + 1;
+  int i;
+
+  data[0] = NETCODING_DISPATCH;
+  cur += pack_varint(cur, generation);
+  *cur++ = num_deltas;
+  for(i = 0; i < num_deltas; i++) {
+    cur += pack_varint(cur, deltas[i]);
+  }
+  *cur = cur - data + 1;
+  cur++;
+  memset(cur, 0, PAYLOAD_SIZE);
+  return cur - data + PAYLOAD_SIZE;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(wire, "Wire format");
+UNIT_TEST(wire)
+{
+  static const uint32_t last_generation =
+    EMPTY_PACKET_ID / NETCODING_GENERATION_SIZE - 1;
+  uint8_t data[NETCODING_MAX_PACKET_SIZE + 16];
+  netcoding_packet packet;
+  uint32_t deltas[2];
+  int len;
+
+  UNIT_TEST_BEGIN();
+
+  deltas[0] = NETCODING_GENERATION_SIZE - 1;
+  len = pack_deltas(data, 3, deltas, 1);
+  UNIT_TEST_ASSERT(unpack_packet_header(data, len, &packet));
+  UNIT_TEST_ASSERT(packet.header.holding_packets[0] ==
+                   4 * NETCODING_GENERATION_SIZE - 1);
+
+  /* Ids outside their generation */
+  deltas[0] = NETCODING_GENERATION_SIZE;
+  len = pack_deltas(data, 3, deltas, 1);
+  UNIT_TEST_ASSERT(!unpack_packet_header(data, len, &packet));
+  deltas[0] = UINT32_MAX;
+  len = pack_deltas(data, 3, deltas, 1);
+  UNIT_TEST_ASSERT(!unpack_packet_header(data, len, &packet));
+
+  /* The last generation whose ids are below EMPTY_PACKET_ID */
+  deltas[0] = NETCODING_GENERATION_SIZE - 1;
+  len = pack_deltas(data, last_generation, deltas, 1);
+  UNIT_TEST_ASSERT(unpack_packet_header(data, len, &packet));
+  UNIT_TEST_ASSERT(packet.header.holding_packets[0] < EMPTY_PACKET_ID);
+  len = pack_deltas(data, last_generation + 1, deltas, 1);
+  UNIT_TEST_ASSERT(!unpack_packet_header(data, len, &packet));
+
+#if NUM_COMBINATIONS > 1
+  deltas[0] = 1;
+  deltas[1] = 2;
+  len = pack_deltas(data, 3, deltas, 2);
+  UNIT_TEST_ASSERT(unpack_packet_header(data, len, &packet));
+  UNIT_TEST_ASSERT(packet.header.holding_packets[1] ==
+                   3 * NETCODING_GENERATION_SIZE + 3);
+
+  /* Duplicate ids */
+  deltas[1] = 0;
+  len = pack_deltas(data, 3, deltas, 2);
+  UNIT_TEST_ASSERT(!unpack_packet_header(data, len, &packet));
+
+  /* The second id past the generation */
+  deltas[1] = NETCODING_GENERATION_SIZE - 1;
+  len = pack_deltas(data, 3, deltas, 2);
+  UNIT_TEST_ASSERT(!unpack_packet_header(data, len, &packet));
+#endif
+
+  /* What pack_packet() writes is read back */
+  packet = create_packet(5 * NETCODING_GENERATION_SIZE + 2, "");
+  len = pack_packet(&packet, data);
+  memset(&packet, 0, sizeof(packet));
+  UNIT_TEST_ASSERT(unpack_packet_header(data, len, &packet));
+  UNIT_TEST_ASSERT(packet.header.holding_packets[0] ==
+                   5 * NETCODING_GENERATION_SIZE + 2);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+/* Counts the packets withheld by the router going to a destination. */
+static int
+count_held(netcoding_addr destination)
+{
+  packet_buffer *buffers[2];
+  linked_list_node *cur_node;
+  int count = 0;
+  int i;
+
+  buffers[0] = &network_coding_node.raw_buffer;
+  buffers[1] = &network_coding_node.combination_buffer;
+  for(i = 0; i < 2; i++) {
+    for(cur_node = buffers[i]->head; cur_node != NULL;
+        cur_node = cur_node->next) {
+      count += ((netcoding_slot *)cur_node)->route.destination == destination;
+    }
+  }
+  return count;
+}
+/*****************************************************************************/
+/* Decodes every native packet of a generation, or only its first one. */
+static void
+decode_generation(uint32_t generation, int whole)
+{
+  uint32_t i;
+
+  for(i = 0; i < (whole ? NETCODING_GENERATION_SIZE : 1); i++) {
+    netcoding_packet packet =
+      create_bench_packet(generation * NETCODING_GENERATION_SIZE + i);
+
+    clear_list(decode_packets(&network_coding_node, &packet));
+  }
+}
+/*****************************************************************************/
+/* Routes a packet of a generation to a destination, as a native packet or
+   as a coded one, and tells whether it was dropped. */
+static int
+is_dropped(uint32_t generation, netcoding_addr destination, int coded)
+{
+  netcoding_node *node = &network_coding_node;
+  netcoding_packet packet =
+    create_bench_packet(generation * NETCODING_GENERATION_SIZE);
+  netcoding_route route;
+  uint32_t dropped = node->stats.counters[NETCODING_EVENT_DROPPED];
+
+  memset(&route, 0, sizeof(route));
+  route.next_hop = 2;
+  route.destination = destination;
+  if(coded) {
+    packet.header.coefficients[0] = 2;
+  }
+  encode_packet(node, &packet, &route);
+  return node->stats.counters[NETCODING_EVENT_DROPPED] != dropped;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(window, "Acknowledgments");
+UNIT_TEST(window)
+{
+  static const netcoding_addr alice = 0x0101;
+  static const netcoding_addr bob = 0x0202;
+  netcoding_node *node = &network_coding_node;
+  netcoding_decoder *decoder = &node->decoder;
+  uint8_t data[NETCODING_ACK_MAX_SIZE];
+  netcoding_addr receiver;
+  uint32_t base, decoded_ahead;
+  uint32_t generation;
+  netcoding_route route;
+  int len;
+
+  UNIT_TEST_BEGIN();
+
+  create_netcoding_node(1);
+  node->transmit = transmit;
+
+  /* Generations whose rows are dropped for lack of slots are not
+     acknowledged */
+  for(generation = 0; generation <= NETCODING_DECODE_GENERATIONS;
+      generation++) {
+    decode_generation(generation, 0);
+  }
+  UNIT_TEST_ASSERT(decoder->acked_generation == 0);
+  UNIT_TEST_ASSERT(decoder->decoded_ahead == 0);
+
+  /* A generation decoded past a missing one is flagged, then acknowledged
+     along with the ones it waited for */
+  decode_generation(2, 1);
+  UNIT_TEST_ASSERT(decoder->acked_generation == 0);
+  UNIT_TEST_ASSERT(decoder->decoded_ahead == 1 << 2);
+  decode_generation(0, 1);
+  UNIT_TEST_ASSERT(decoder->acked_generation == 1);
+  UNIT_TEST_ASSERT(decoder->decoded_ahead == 1 << 1);
+  decode_generation(1, 1);
+  UNIT_TEST_ASSERT(decoder->acked_generation == 3);
+  UNIT_TEST_ASSERT(decoder->decoded_ahead == 0);
+
+  /* A generation decoded too far ahead to be flagged moves the
+     acknowledgment to the oldest generation still being decoded */
+  decode_generation(1000, 0);
+  decode_generation(1001, 1);
+  UNIT_TEST_ASSERT(decoder->acked_generation == 1000);
+  UNIT_TEST_ASSERT(decoder->decoded_ahead == 1 << 1);
+  decode_generation(1000, 1);
+  UNIT_TEST_ASSERT(decoder->acked_generation == 1002);
+  UNIT_TEST_ASSERT(decoder->decoded_ahead == 0);
+  decode_generation(2000, 1);
+  UNIT_TEST_ASSERT(decoder->acked_generation == 2001);
+  UNIT_TEST_ASSERT(decoder->decoded_ahead == 0);
+
+  /* The acknowledgment goes through the wire */
+  len = pack_ack(alice, 3, 1 << 2, data);
+  UNIT_TEST_ASSERT(unpack_ack(data, len, &receiver, &base, &decoded_ahead));
+  UNIT_TEST_ASSERT(receiver == alice && base == 3 && decoded_ahead == 1 << 2);
+  UNIT_TEST_ASSERT(!unpack_ack(data, len - 1, &receiver, &base,
+                               &decoded_ahead));
+
+  /* Each receiver has its own window, and the coded packets of the
+     generations it decoded are dropped, not the native ones */
+  UNIT_TEST_ASSERT(acknowledge_generations(node, alice, 3, 1 << 2));
+  UNIT_TEST_ASSERT(!acknowledge_generations(node, alice, 3, 1 << 2));
+  UNIT_TEST_ASSERT(!acknowledge_generations(node, alice, 2, 0));
+  UNIT_TEST_ASSERT(is_dropped(2, alice, 1));
+  UNIT_TEST_ASSERT(is_dropped(5, alice, 1));
+  UNIT_TEST_ASSERT(!is_dropped(4, alice, 1));
+  UNIT_TEST_ASSERT(!is_dropped(2, alice, 0));
+  UNIT_TEST_ASSERT(!is_dropped(2, bob, 1));
+
+  /* Only the withheld packets going to the receiver are evicted */
+  memset(&route, 0, sizeof(route));
+  for(generation = 6; generation < 8; generation++) {
+    netcoding_packet packet =
+      create_bench_packet(generation * NETCODING_GENERATION_SIZE);
+
+    route.next_hop = 2;
+    route.destination = alice;
+    UNIT_TEST_ASSERT(hold_packet(node, &packet, packet.body, &route,
+                                 CLOCK_SECOND));
+    packet = create_bench_packet(generation * NETCODING_GENERATION_SIZE + 1);
+    route.destination = bob;
+    UNIT_TEST_ASSERT(hold_packet(node, &packet, packet.body, &route,
+                                 CLOCK_SECOND));
+  }
+  UNIT_TEST_ASSERT(acknowledge_generations(node, alice, 3, 1 << 4));
+  UNIT_TEST_ASSERT(count_held(alice) == 1);
+  UNIT_TEST_ASSERT(acknowledge_generations(node, alice, 8, 0));
+  UNIT_TEST_ASSERT(count_held(alice) == 0);
+  UNIT_TEST_ASSERT(count_held(bob) == 2);
+
+  /* The acknowledgments of receivers beyond the windows are ignored */
+  for(receiver = 1; receiver < NETCODING_RECEIVERS; receiver++) {
+    UNIT_TEST_ASSERT(acknowledge_generations(node, receiver, 1, 0));
+  }
+  UNIT_TEST_ASSERT(!acknowledge_generations(node, receiver, 1, 0));
+  UNIT_TEST_ASSERT(!acknowledge_generations(node, NETCODING_ADDR_NONE, 1, 0));
+
+  while(node->raw_buffer.head != NULL) {
+    remove_slot(&node->raw_buffer, (netcoding_slot *)node->raw_buffer.head);
+  }
+  ctimer_stop(&node->hold_timer);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+/* The senders and the router of simulacoes/2-sender-1rcvr.csc, and the
+   number of packets each sender sends. */
+static const uint16_t sender_ids[] = { 4, 5 };
+#define ROUTER_ID 3
+#define SENDER_PACKETS NETCODING_GENERATION_SIZE
+
+static unsigned num_mixed;
+/*****************************************************************************/
+/* The sender of a packet id, or -1 if none of them sent it. */
+static int
+get_sender(uint32_t packet_id)
+{
+  uint32_t seq;
+  int i;
+
+  for(i = 0; i < 2; i++) {
+    for(seq = 0; seq < SENDER_PACKETS; seq++) {
+      if(get_sender_packet_id(sender_ids[i], seq) == packet_id) {
+        return i;
+      }
+    }
+  }
+  return -1;
+}
+/*****************************************************************************/
+/* A transmission of the router, counted if it combines the packets of both
+   senders. */
+static void
+count_mixed(netcoding_packet *packet, netcoding_route *route)
+{
+  int senders = 0;
+  int i, sender;
+
+  for(i = 0; i < get_header_num_packets(&packet->header); i++) {
+    sender = get_sender(packet->header.holding_packets[i]);
+    if(sender >= 0) {
+      senders |= 1 << sender;
+    }
+  }
+  num_mixed += senders == 3;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(senders, "Senders sharing generations");
+UNIT_TEST(senders)
+{
+  netcoding_node *node = &network_coding_node;
+  netcoding_route route;
+  uint32_t seq;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  create_netcoding_combinatory_routing_node(ROUTER_ID);
+  node->prob_to_combine = 100;
+  node->transmit = count_mixed;
+  memset(&route, 0, sizeof(route));
+  route.next_hop = NUM_RECEIVERS;
+  route.destination = NUM_RECEIVERS;
+
+  /* Each round, both senders send their next packet to the receiver */
+  for(seq = 0; seq < SENDER_PACKETS; seq++) {
+    for(i = 0; i < 2; i++) {
+      netcoding_packet packet =
+        create_bench_packet(get_sender_packet_id(sender_ids[i], seq));
+
+      UNIT_TEST_ASSERT(get_sender(packet.header.holding_packets[0]) == i);
+      if(encode_packet(node, &packet, &route)) {
+        count_mixed(&packet, &route);
+      }
+    }
+  }
+  while(node->combination_buffer.head != NULL) {
+    flush_packet(node, &node->combination_buffer,
+                 (netcoding_slot *)node->combination_buffer.head);
+  }
+  while(node->raw_buffer.head != NULL) {
+    flush_packet(node, &node->raw_buffer,
+                 (netcoding_slot *)node->raw_buffer.head);
+  }
+  ctimer_stop(&node->hold_timer);
+
+  /* The flows of the senders are coded together */
+  UNIT_TEST_ASSERT(num_mixed > 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_netcoding_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(coding);
+  UNIT_TEST_RUN(xor);
+  UNIT_TEST_RUN(hash);
+  UNIT_TEST_RUN(wire);
+  UNIT_TEST_RUN(window);
+  UNIT_TEST_RUN(senders);
+
+  if(!UNIT_TEST_PASSED(coding) ||
+     !UNIT_TEST_PASSED(xor) ||
+     !UNIT_TEST_PASSED(hash) ||
+     !UNIT_TEST_PASSED(wire) ||
+     !UNIT_TEST_PASSED(window) ||
+     !UNIT_TEST_PASSED(senders)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*****************************************************************************/
@@ -0,0 +1,3 @@
+#!/bin/sh -e
+
+./run-one.sh 16-ds6-route
@@ -0,0 +1,7 @@
+#ifndef PROJECT_CONF_H
+#define PROJECT_CONF_H
+
+/* A routing table the size of a busy border router. */
+#define UIP_CONF_MAX_ROUTES 500
+
+#endif /* !PROJECT_CONF_H */
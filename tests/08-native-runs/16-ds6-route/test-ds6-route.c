@@ -0,0 +1,292 @@
+/*
+ * \file
+ *      Tests and benchmark of the IPv6 routing table lookups.
+ *
+ *      Fills the routing table with host routes and prefixes of several
+ *      lengths through a few neighbors and checks that
+ *      uip_ds6_route_lookup() finds the longest matching prefix while routes
+ *      come and go. Setting the number of lookups also times it against a
+ *      walk over every route, e.g.
+ *      make DEFINES=UIP_DS6_ROUTE_CONF_WITH_INDEX=1,BENCH_CONF_LOOKUPS=100000
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/ipv6/uip-ds6.h"
+#include "net/ipv6/uip-ds6-nbr.h"
+#include "net/ipv6/uip-ds6-route.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of routes added, at most UIP_DS6_ROUTE_NB. */
+#ifdef BENCH_CONF_ROUTES
+#define BENCH_ROUTES BENCH_CONF_ROUTES
+#else
+#define BENCH_ROUTES UIP_DS6_ROUTE_NB
+#endif
+
+/* Number of neighbors the routes go through. */
+#define NUM_NEXTHOPS 4
+/*****************************************************************************/
+PROCESS(test_ds6_route_process, "IPv6 route lookup test");
+AUTOSTART_PROCESSES(&test_ds6_route_process);
+
+static uip_ipaddr_t nexthops[NUM_NEXTHOPS];
+static struct uip_ds6_notification notification;
+static int routes_added;
+static int routes_removed;
+/*****************************************************************************/
+static void
+route_callback(int event, const uip_ipaddr_t *route,
+               const uip_ipaddr_t *nexthop, int num_routes)
+{
+  if(event == UIP_DS6_NOTIFICATION_ROUTE_ADD) {
+    routes_added++;
+  } else if(event == UIP_DS6_NOTIFICATION_ROUTE_RM) {
+    routes_removed++;
+  }
+}
+/*****************************************************************************/
+/*
+ * The prefix of route i: a /48 every 50 routes, a /64 every 10 routes
+ * nested in the /48s, and host routes nested in the /64s otherwise.
+ */
+static uint8_t
+route_prefix(int i, uip_ipaddr_t *prefix)
+{
+  uip_ip6addr(prefix, 0xfd00, i / 50, (i / 10) % 5, 0, 0, 0, 0, i);
+  if(i % 50 == 0) {
+    return 48;
+  }
+  if(i % 10 == 0) {
+    return 64;
+  }
+  return 128;
+}
+/*****************************************************************************/
+/* An address to look up: a routed host, a host of a /64 or /48 without a
+   host route, or an address without a route. */
+static void
+lookup_address(unsigned n, uip_ipaddr_t *addr)
+{
+  int i = n % BENCH_ROUTES;
+
+  route_prefix(i, addr);
+  switch(n % 4) {
+  case 1:
+    addr->u16[7] = UIP_HTONS(0xffff);
+    break;
+  case 2:
+    addr->u16[2] = UIP_HTONS(0xffff);
+    break;
+  case 3:
+    addr->u16[0] = UIP_HTONS(0xfe00);
+    break;
+  }
+}
+/*****************************************************************************/
+/* The route with the longest matching prefix, found by walking every
+   route as uip_ds6_route_lookup() does without an index. */
+static uip_ds6_route_t *
+walk_lookup(const uip_ipaddr_t *addr)
+{
+  uip_ds6_route_t *r;
+  uip_ds6_route_t *found_route = NULL;
+  uint8_t longestmatch = 0;
+
+  for(r = uip_ds6_route_head(); r != NULL; r = uip_ds6_route_next(r)) {
+    if(r->length >= longestmatch &&
+       uip_ipaddr_prefixcmp(addr, &r->ipaddr, r->length)) {
+      longestmatch = r->length;
+      found_route = r;
+      if(longestmatch == 128) {
+        break;
+      }
+    }
+  }
+  return found_route;
+}
+/*****************************************************************************/
+static int
+check_lookups(void)
+{
+  uip_ipaddr_t addr;
+  unsigned n;
+
+  for(n = 0; n < 4 * BENCH_ROUTES; n++) {
+    lookup_address(n, &addr);
+    if(uip_ds6_route_lookup(&addr) != walk_lookup(&addr)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*****************************************************************************/
+/* Add every route, the longest prefixes first: uip_ds6_route_add()
+   replaces the route matching the new prefix, which would be the
+   shorter prefix it nests in. */
+static int
+add_routes(void)
+{
+  static const uint8_t lengths[] = { 128, 64, 48 };
+  uip_ipaddr_t prefix;
+  int i;
+  int j;
+
+  for(j = 0; j < sizeof(lengths); j++) {
+    for(i = 0; i < BENCH_ROUTES; i++) {
+      if(route_prefix(i, &prefix) == lengths[j] &&
+         uip_ds6_route_add(&prefix, lengths[j],
+                           &nexthops[i % NUM_NEXTHOPS]) == NULL) {
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(lookup, "Longest prefix match");
+UNIT_TEST(lookup)
+{
+  uip_lladdr_t lladdr;
+  uip_ipaddr_t prefix;
+  uip_ds6_route_t *r;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  memset(&lladdr, 0, sizeof(lladdr));
+  for(i = 0; i < NUM_NEXTHOPS; i++) {
+    uip_ip6addr(&nexthops[i], 0xfe80, 0, 0, 0, 0, 0, 0, i + 1);
+    lladdr.addr[sizeof(lladdr.addr) - 1] = i + 1;
+    UNIT_TEST_ASSERT(uip_ds6_nbr_add(&nexthops[i], &lladdr, 1,
+                                     NBR_REACHABLE, NBR_TABLE_REASON_ROUTE,
+                                     NULL) != NULL);
+  }
+  uip_ds6_notification_add(&notification, route_callback);
+
+  UNIT_TEST_ASSERT(add_routes());
+  UNIT_TEST_ASSERT(uip_ds6_route_num_routes() == BENCH_ROUTES);
+  UNIT_TEST_ASSERT(routes_added == BENCH_ROUTES);
+  UNIT_TEST_ASSERT(check_lookups());
+
+  /* Adding a route again through the same neighbor changes nothing */
+  route_prefix(1, &prefix);
+  r = uip_ds6_route_lookup(&prefix);
+  UNIT_TEST_ASSERT(r != NULL && r->length == 128);
+  UNIT_TEST_ASSERT(uip_ds6_route_add(&prefix, 128,
+                                     &nexthops[1 % NUM_NEXTHOPS]) == r);
+  UNIT_TEST_ASSERT(routes_added == BENCH_ROUTES);
+
+  /* Through another neighbor, it replaces the route */
+  UNIT_TEST_ASSERT(uip_ds6_route_add(&prefix, 128, &nexthops[0]) != NULL);
+  UNIT_TEST_ASSERT(routes_added == BENCH_ROUTES + 1);
+  UNIT_TEST_ASSERT(routes_removed == 1);
+  UNIT_TEST_ASSERT(uip_ipaddr_cmp(uip_ds6_route_nexthop(
+                                    uip_ds6_route_lookup(&prefix)),
+                                  &nexthops[0]));
+
+  /* Remove every other route, the /48s and /64s too, then every route
+     through a neighbor, then the rest */
+  for(i = 0; i < BENCH_ROUTES; i += 2) {
+    route_prefix(i, &prefix);
+    uip_ds6_route_rm(uip_ds6_route_lookup(&prefix));
+  }
+  UNIT_TEST_ASSERT(uip_ds6_route_num_routes() == BENCH_ROUTES / 2);
+  UNIT_TEST_ASSERT(check_lookups());
+
+  uip_ds6_route_rm_by_nexthop(&nexthops[1]);
+  UNIT_TEST_ASSERT(uip_ds6_route_num_routes() < BENCH_ROUTES / 2);
+  UNIT_TEST_ASSERT(check_lookups());
+
+  for(i = 0; i < NUM_NEXTHOPS; i++) {
+    uip_ds6_route_rm_by_nexthop(&nexthops[i]);
+  }
+  UNIT_TEST_ASSERT(uip_ds6_route_num_routes() == 0);
+  UNIT_TEST_ASSERT(routes_removed == routes_added);
+  UNIT_TEST_ASSERT(uip_ds6_route_lookup(&prefix) == NULL);
+
+  UNIT_TEST_ASSERT(add_routes());
+  UNIT_TEST_ASSERT(uip_ds6_route_num_routes() == BENCH_ROUTES);
+  UNIT_TEST_ASSERT(routes_added - routes_removed == BENCH_ROUTES);
+  UNIT_TEST_ASSERT(check_lookups());
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+#ifdef BENCH_CONF_LOOKUPS
+/* Number of lookups timed. */
+#define BENCH_LOOKUPS BENCH_CONF_LOOKUPS
+
+static uint64_t
+now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+/* Times the lookups of the routes left by the test. Only built on request:
+   the timings depend on the host, so they are printed, not checked. */
+static void
+benchmark(void)
+{
+  static uip_ipaddr_t addrs[256];
+  unsigned found_lookup = 0;
+  unsigned found_walk = 0;
+  uint64_t start;
+  double lookup_ns;
+  double walk_ns;
+  unsigned n;
+
+  for(n = 0; n < 256; n++) {
+    lookup_address(random_rand(), &addrs[n]);
+  }
+
+  start = now_ns();
+  for(n = 0; n < BENCH_LOOKUPS; n++) {
+    found_lookup += uip_ds6_route_lookup(&addrs[n % 256]) != NULL;
+  }
+  lookup_ns = (double)(now_ns() - start) / BENCH_LOOKUPS;
+
+  start = now_ns();
+  for(n = 0; n < BENCH_LOOKUPS; n++) {
+    found_walk += walk_lookup(&addrs[n % 256]) != NULL;
+  }
+  walk_ns = (double)(now_ns() - start) / BENCH_LOOKUPS;
+
+  printf("uip_ds6_route_lookup: %d routes, index %s, %.1f ns/op "
+         "(walk over the routes %.1f ns/op), %u and %u found\n",
+         uip_ds6_route_num_routes(), UIP_DS6_ROUTE_WITH_INDEX ? "on" : "off",
+         lookup_ns, walk_ns, found_lookup, found_walk);
+}
+#endif /* BENCH_CONF_LOOKUPS */
+/*****************************************************************************/
+PROCESS_THREAD(test_ds6_route_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(lookup);
+#ifdef BENCH_CONF_LOOKUPS
+  benchmark();
+#endif
+
+  if(!UNIT_TEST_PASSED(lookup)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
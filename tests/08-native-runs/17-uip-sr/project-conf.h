@@ -0,0 +1,7 @@
+#ifndef PROJECT_CONF_H
+#define PROJECT_CONF_H
+
+/* The graph of a large non-storing network, at its root. */
+#define UIP_SR_CONF_LINK_NUM 1100
+
+#endif /* !PROJECT_CONF_H */
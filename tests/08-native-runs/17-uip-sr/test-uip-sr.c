@@ -0,0 +1,336 @@
+/*
+ * \file
+ *      Tests and benchmark of the source routing graph of a non-storing
+ *      root.
+ *
+ *      Starts a RPL root, fills its graph with a binary tree of nodes and
+ *      checks node lookups, source routes and the SRH inserted in packets
+ *      towards every node while links change, nodes expire and come back.
+ *      With BENCH_CONF_ITERATIONS, it then times the lookups and SRH
+ *      insertions, e.g.
+ *      make DEFINES=UIP_SR_CONF_WITH_INDEX=1,BENCH_CONF_ITERATIONS=100000
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/ipv6/uip.h"
+#include "net/ipv6/uipbuf.h"
+#include "net/ipv6/uip-sr.h"
+#include "net/routing/routing.h"
+#include "unit-test/unit-test.h"
+
+#if ROUTING_CONF_RPL_CLASSIC
+#include "net/routing/rpl-classic/rpl.h"
+/* RPL Classic keeps a graph per DAG */
+#define GRAPH rpl_get_any_dag()
+#else
+#define GRAPH NULL
+#endif
+/*****************************************************************************/
+/* Number of nodes below the root, fewer than UIP_SR_LINK_NUM. */
+#ifdef BENCH_CONF_NODES
+#define BENCH_NODES BENCH_CONF_NODES
+#else
+#define BENCH_NODES 1000
+#endif
+
+#define LIFETIME 3600
+/*****************************************************************************/
+PROCESS(test_uip_sr_process, "Source routing test");
+AUTOSTART_PROCESSES(&test_uip_sr_process);
+
+static uip_ipaddr_t root_addr;
+/*****************************************************************************/
+/* The address of node i. The varying interface identifiers make the
+   SRH compression of the routes vary too. */
+static void
+node_addr(int i, uip_ipaddr_t *addr)
+{
+  uip_ip6addr(addr, 0xfd00, 0, 0, 0, 0x0200 + i % 3, 0, 0, i + 1);
+}
+/*****************************************************************************/
+/* Node i joins the graph, below node i / 2 - 1 or the root */
+static uip_sr_node_t *
+join(int i)
+{
+  uip_ipaddr_t child;
+  uip_ipaddr_t parent;
+
+  node_addr(i, &child);
+  if(i < 2) {
+    uip_ipaddr_copy(&parent, &root_addr);
+  } else {
+    node_addr(i / 2 - 1, &parent);
+  }
+  return uip_sr_update_node(GRAPH, &child, &parent, LIFETIME);
+}
+/*****************************************************************************/
+/* The node of an address, found by walking every node */
+static uip_sr_node_t *
+walk_get_node(const uip_ipaddr_t *addr)
+{
+  uip_sr_node_t *node;
+  uip_ipaddr_t ipaddr;
+
+  for(node = uip_sr_node_head(); node != NULL; node = uip_sr_node_next(node)) {
+    NETSTACK_ROUTING.get_sr_node_ipaddr(&ipaddr, node);
+    if(uip_ipaddr_cmp(&ipaddr, addr)) {
+      return node;
+    }
+  }
+  return NULL;
+}
+/*****************************************************************************/
+/* The source route to a node, found by walking up to the root */
+static int
+walk_get_path(const uip_sr_node_t *root, const uip_sr_node_t *node,
+              uint8_t *path_len, uint8_t *cmpr)
+{
+  int max_depth = UIP_SR_LINK_NUM;
+  uip_ipaddr_t node_ipaddr;
+  uip_ipaddr_t hop_ipaddr;
+  int i;
+
+  *path_len = 0;
+  *cmpr = 15;
+  if(node == NULL || root == NULL) {
+    return 0;
+  }
+  NETSTACK_ROUTING.get_sr_node_ipaddr(&node_ipaddr, node);
+  for(node = node->parent; node != NULL && node != root && max_depth > 0;
+      node = node->parent, max_depth--) {
+    NETSTACK_ROUTING.get_sr_node_ipaddr(&hop_ipaddr, node);
+    for(i = 0; i < *cmpr && hop_ipaddr.u8[i] == node_ipaddr.u8[i]; i++);
+    *cmpr = i;
+    (*path_len)++;
+  }
+  return node == root;
+}
+/*****************************************************************************/
+static void
+build_packet(const uip_ipaddr_t *dest)
+{
+  uipbuf_clear();
+  memset(uip_buf, 0, UIP_IPH_LEN + UIP_UDPH_LEN);
+  UIP_IP_BUF->vtc = 0x60;
+  UIP_IP_BUF->proto = UIP_PROTO_UDP;
+  UIP_IP_BUF->ttl = 64;
+  uip_ipaddr_copy(&UIP_IP_BUF->srcipaddr, &root_addr);
+  uip_ipaddr_copy(&UIP_IP_BUF->destipaddr, dest);
+  uip_len = UIP_IPH_LEN + UIP_UDPH_LEN;
+  uipbuf_set_len_field(UIP_IP_BUF, UIP_UDPH_LEN);
+}
+/*****************************************************************************/
+/* Insert the SRH towards a node, then forward the packet along it as the
+   nodes of the route would, checking every hop */
+static int
+check_srh(const uip_ipaddr_t *addr, const uip_sr_node_t *root,
+          const uip_sr_node_t *node)
+{
+  const uip_sr_node_t *hops[BENCH_NODES];
+  uip_ipaddr_t hop_ipaddr;
+  int num_hops = 0;
+
+  build_packet(addr);
+  if(!NETSTACK_ROUTING.ext_header_update()) {
+    return 0;
+  }
+
+  /* The route, from the destination up to the child of the root */
+  for(; node != root; node = node->parent) {
+    hops[num_hops++] = node;
+  }
+  while(num_hops > 0) {
+    NETSTACK_ROUTING.get_sr_node_ipaddr(&hop_ipaddr, hops[--num_hops]);
+    if(!uip_ipaddr_cmp(&hop_ipaddr, &UIP_IP_BUF->destipaddr) ||
+       (num_hops > 0 && !NETSTACK_ROUTING.ext_header_srh_update())) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*****************************************************************************/
+static int
+check_graph(void)
+{
+  uip_ipaddr_t addr;
+  uip_sr_node_t *root;
+  uip_sr_node_t *node;
+  uint8_t path_len;
+  uint8_t cmpr;
+  uint8_t walk_path_len;
+  uint8_t walk_cmpr;
+  int reachable;
+  int i;
+
+  root = uip_sr_get_node(GRAPH, &root_addr);
+  if(root == NULL || root != walk_get_node(&root_addr)) {
+    return 0;
+  }
+
+  for(i = 0; i < BENCH_NODES; i++) {
+    node_addr(i, &addr);
+    node = uip_sr_get_node(GRAPH, &addr);
+    if(node != walk_get_node(&addr)) {
+      return 0;
+    }
+    reachable = walk_get_path(root, node, &walk_path_len, &walk_cmpr);
+    if(uip_sr_get_path(root, node, &path_len, &cmpr) != reachable ||
+       uip_sr_is_addr_reachable(GRAPH, &addr) != reachable ||
+       (reachable && (path_len != walk_path_len || cmpr != walk_cmpr))) {
+      return 0;
+    }
+    if(reachable && !check_srh(&addr, root, node)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(graph, "Source routes");
+UNIT_TEST(graph)
+{
+  uip_ipaddr_t child;
+  uip_ipaddr_t parent;
+  uip_sr_node_t *node;
+  int num_expired;
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  for(i = 0; i < BENCH_NODES; i++) {
+    UNIT_TEST_ASSERT(join(i) != NULL);
+  }
+  UNIT_TEST_ASSERT(uip_sr_num_nodes() == BENCH_NODES + 1);
+  UNIT_TEST_ASSERT(check_graph());
+
+  /* Move the subtree of node 1 below node 0 */
+  node_addr(1, &child);
+  node_addr(0, &parent);
+  UNIT_TEST_ASSERT(uip_sr_update_node(GRAPH, &child, &parent, LIFETIME));
+  UNIT_TEST_ASSERT(check_graph());
+
+  /* Node 0 below node 5 would make a loop, the update is not taken */
+  node_addr(0, &child);
+  node_addr(5, &parent);
+  node = uip_sr_update_node(GRAPH, &child, &parent, LIFETIME);
+  UNIT_TEST_ASSERT(node != NULL &&
+                   node->parent == uip_sr_get_node(GRAPH, &root_addr));
+  UNIT_TEST_ASSERT(check_graph());
+
+  /* Expire the links of the leaves, which are removed */
+  num_expired = 0;
+  for(i = BENCH_NODES / 2; i < BENCH_NODES; i++) {
+    node_addr(i, &child);
+    node_addr(i / 2 - 1, &parent);
+    uip_sr_expire_parent(GRAPH, &child, &parent);
+    num_expired++;
+  }
+  uip_sr_periodic(UIP_SR_REMOVAL_DELAY);
+  uip_sr_periodic(1);
+  UNIT_TEST_ASSERT(uip_sr_num_nodes() == BENCH_NODES + 1 - num_expired);
+  UNIT_TEST_ASSERT(check_graph());
+
+  /* The leaves come back, in reverse order */
+  for(i = BENCH_NODES - 1; i >= BENCH_NODES / 2; i--) {
+    UNIT_TEST_ASSERT(join(i) != NULL);
+  }
+  UNIT_TEST_ASSERT(uip_sr_num_nodes() == BENCH_NODES + 1);
+  UNIT_TEST_ASSERT(check_graph());
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+#ifdef BENCH_CONF_ITERATIONS
+/* Number of lookups and SRH insertions timed. */
+#define BENCH_ITERATIONS BENCH_CONF_ITERATIONS
+
+static uint64_t
+now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+/* Times the lookups and SRH insertions in the graph the test left, to
+   compare the index against the walk by hand; the regression run only
+   checks the results. */
+static void
+benchmark(void)
+{
+  static uip_ipaddr_t addrs[256];
+  unsigned found_lookup = 0;
+  unsigned found_walk = 0;
+  unsigned inserted = 0;
+  uint64_t start;
+  double lookup_ns;
+  double walk_ns;
+  double srh_ns;
+  unsigned n;
+
+  for(n = 0; n < 256; n++) {
+    node_addr(random_rand() % BENCH_NODES, &addrs[n]);
+  }
+
+  start = now_ns();
+  for(n = 0; n < BENCH_ITERATIONS; n++) {
+    found_lookup += uip_sr_get_node(GRAPH, &addrs[n % 256]) != NULL;
+  }
+  lookup_ns = (double)(now_ns() - start) / BENCH_ITERATIONS;
+
+  start = now_ns();
+  for(n = 0; n < BENCH_ITERATIONS; n++) {
+    found_walk += walk_get_node(&addrs[n % 256]) != NULL;
+  }
+  walk_ns = (double)(now_ns() - start) / BENCH_ITERATIONS;
+
+  start = now_ns();
+  for(n = 0; n < BENCH_ITERATIONS; n++) {
+    build_packet(&addrs[n % 256]);
+    inserted += NETSTACK_ROUTING.ext_header_update();
+  }
+  srh_ns = (double)(now_ns() - start) / BENCH_ITERATIONS;
+
+  printf("uip_sr_get_node: %d nodes, index %s, %.1f ns/op "
+         "(walk over the nodes %.1f ns/op), %u and %u of %u found\n",
+         uip_sr_num_nodes(), UIP_SR_WITH_INDEX ? "on" : "off",
+         lookup_ns, walk_ns, found_lookup, found_walk, n);
+  printf("SRH insertion: %.1f ns/op, %u of %u inserted\n",
+         srh_ns, inserted, n);
+}
+#endif /* BENCH_CONF_ITERATIONS */
+/*****************************************************************************/
+PROCESS_THREAD(test_uip_sr_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  NETSTACK_ROUTING.root_set_prefix(NULL, NULL);
+  NETSTACK_ROUTING.root_start();
+  NETSTACK_ROUTING.get_root_ipaddr(&root_addr);
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  UNIT_TEST_RUN(graph);
+#ifdef BENCH_CONF_ITERATIONS
+  benchmark();
+#endif
+
+  if(!UNIT_TEST_PASSED(graph)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
@@ -0,0 +1,9 @@
+#ifndef PROJECT_CONF_H
+#define PROJECT_CONF_H
+
+/* A heap smaller than the timers of the test, which overflow to the list. */
+#ifndef ETIMER_CONF_HEAP_SIZE
+#define ETIMER_CONF_HEAP_SIZE 64
+#endif
+
+#endif /* !PROJECT_CONF_H */
@@ -0,0 +1,284 @@
+/*
+ * \file
+ *      Tests and benchmark of the event timers.
+ *
+ *      Sets a few hundred event timers, stops, adjusts and restarts some
+ *      of them while another process exits with its own timers pending,
+ *      and checks that every pending timer expires once, on time, and
+ *      that the next expiration is never later than the earliest of
+ *      them. Then sets and stops timers among many pending ones, which is
+ *      timed when the number of operations is given, e.g.
+ *      make DEFINES=ETIMER_CONF_HEAP_SIZE=512,BENCH_CONF_OPS=100000
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of timers set by the test process. */
+#ifdef BENCH_CONF_TIMERS
+#define BENCH_TIMERS BENCH_CONF_TIMERS
+#else
+#define BENCH_TIMERS 300
+#endif
+
+/* Number of timers set and stopped among the pending ones, only timed if
+   set, since the host clock makes the figures vary from run to run. */
+#ifdef BENCH_CONF_OPS
+#define BENCH_OPS BENCH_CONF_OPS
+#else
+#define BENCH_OPS 1000
+#endif
+
+/* Number of timers pending when the exiting process exits. */
+#define EXIT_TIMERS 100
+
+/* The timers expire within this time, and at most this late. */
+#define SPAN (CLOCK_SECOND / 4)
+#define SLACK CLOCK_SECOND
+
+/* Whether the heap holds every timer, those of the system included, and
+   so expires them in order. */
+#define IN_ORDER (ETIMER_HEAP_SIZE >= BENCH_TIMERS + EXIT_TIMERS + 50)
+
+enum {
+  TIMER_PENDING,
+  TIMER_STOPPED,
+  TIMER_EXPIRED,
+};
+/*****************************************************************************/
+PROCESS(test_etimer_process, "Event timer test");
+PROCESS(exiting_process, "Exiting process");
+AUTOSTART_PROCESSES(&test_etimer_process);
+
+static struct etimer timers[BENCH_TIMERS];
+static uint8_t states[BENCH_TIMERS];
+static struct etimer exit_timers[EXIT_TIMERS];
+static struct etimer deadline;
+static unsigned num_pending;
+static unsigned num_expired;
+static unsigned num_early;
+static unsigned num_late;
+static unsigned num_unexpected;
+static unsigned num_next_late;
+static unsigned num_out_of_order;
+/*****************************************************************************/
+#ifdef BENCH_CONF_OPS
+static uint64_t
+now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#endif /* BENCH_CONF_OPS */
+/*****************************************************************************/
+static clock_time_t
+random_interval(void)
+{
+  return SPAN / 5 + random_rand() % SPAN;
+}
+/*****************************************************************************/
+/* Whether a expires later than b, across clock wraps. */
+static int
+later(clock_time_t a, clock_time_t b)
+{
+  return (clock_time_t)(b - a) > (clock_time_t)~(clock_time_t)0 / 2;
+}
+/*****************************************************************************/
+/* The next expiration, of every timer of the system, must not be later
+   than the earliest of the pending timers of the test, leaving out those
+   that expired and wait for the event timer process. */
+static void
+check_next_expiration(void)
+{
+  clock_time_t earliest = 0;
+  int found = 0;
+  int i;
+
+  for(i = 0; i < BENCH_TIMERS; i++) {
+    if(states[i] == TIMER_PENDING && !timer_expired(&timers[i].timer) &&
+       (!found || later(earliest, etimer_expiration_time(&timers[i])))) {
+      earliest = etimer_expiration_time(&timers[i]);
+      found = 1;
+    }
+  }
+  if(found && (!etimer_pending() ||
+               later(etimer_next_expiration_time(), earliest))) {
+    num_next_late++;
+  }
+}
+/*****************************************************************************/
+static void
+timer_expired_event(struct etimer *t)
+{
+  int i;
+  int j;
+
+  if(t < timers || t >= timers + BENCH_TIMERS) {
+    num_unexpected++;
+    return;
+  }
+  i = t - timers;
+  if(states[i] != TIMER_PENDING || !etimer_expired(t)) {
+    num_unexpected++;
+    return;
+  }
+  for(j = 0; j < BENCH_TIMERS; j++) {
+    if(states[j] == TIMER_PENDING && !etimer_expired(&timers[j]) &&
+       later(etimer_expiration_time(t), etimer_expiration_time(&timers[j]))) {
+      num_out_of_order++;
+    }
+  }
+  if(later(etimer_expiration_time(t), clock_time())) {
+    num_early++;
+  } else if(clock_time() - etimer_expiration_time(t) > SLACK) {
+    num_late++;
+  }
+  states[i] = TIMER_EXPIRED;
+  num_pending--;
+  num_expired++;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(expiration, "Expiration");
+UNIT_TEST(expiration)
+{
+  UNIT_TEST_BEGIN();
+
+  UNIT_TEST_ASSERT(num_pending == 0);
+  UNIT_TEST_ASSERT(num_expired > BENCH_TIMERS / 2);
+  UNIT_TEST_ASSERT(num_early == 0);
+  UNIT_TEST_ASSERT(num_late == 0);
+  UNIT_TEST_ASSERT(num_unexpected == 0);
+  UNIT_TEST_ASSERT(num_next_late == 0);
+  UNIT_TEST_ASSERT(!IN_ORDER || num_out_of_order == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(stop, "Set and stop");
+UNIT_TEST(stop)
+{
+  static struct etimer extra[16];
+#ifdef BENCH_CONF_OPS
+  uint64_t start;
+#endif
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  /* Timers that do not expire during the test */
+  for(i = 0; i < BENCH_TIMERS; i++) {
+    etimer_set(&timers[i], CLOCK_SECOND * 3600 + random_rand());
+  }
+
+#ifdef BENCH_CONF_OPS
+  start = now_ns();
+#endif
+  for(i = 0; i < BENCH_OPS; i++) {
+    etimer_set(&extra[i % 16], CLOCK_SECOND * 3600 + random_rand());
+    etimer_stop(&extra[(i + 8) % 16]);
+  }
+#ifdef BENCH_CONF_OPS
+  printf("etimer_set+etimer_stop: %d timers pending, heap size %d, "
+         "%.1f ns/op\n", BENCH_TIMERS, ETIMER_HEAP_SIZE,
+         (double)(now_ns() - start) / BENCH_OPS);
+#endif
+
+  for(i = 0; i < 16; i++) {
+    etimer_stop(&extra[i]);
+    UNIT_TEST_ASSERT(etimer_expired(&extra[i]));
+  }
+  for(i = 0; i < BENCH_TIMERS; i++) {
+    UNIT_TEST_ASSERT(!etimer_expired(&timers[i]));
+    etimer_stop(&timers[i]);
+    UNIT_TEST_ASSERT(etimer_expired(&timers[i]));
+  }
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(exiting_process, ev, data)
+{
+  int i;
+
+  PROCESS_BEGIN();
+
+  /* Exit with timers pending that expire before those of the test
+     process */
+  for(i = 0; i < EXIT_TIMERS; i++) {
+    etimer_set(&exit_timers[i], 1 + random_rand() % (SPAN / 5));
+  }
+
+  PROCESS_END();
+}
+/*****************************************************************************/
+PROCESS_THREAD(test_etimer_process, ev, data)
+{
+  static int i;
+
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  for(i = 0; i < BENCH_TIMERS; i++) {
+    etimer_set(&timers[i], random_interval());
+    states[i] = TIMER_PENDING;
+    num_pending++;
+    check_next_expiration();
+    if(i == BENCH_TIMERS / 2) {
+      process_start(&exiting_process, NULL);
+    }
+  }
+
+  /* Stop, move and restart some of the timers */
+  for(i = 0; i < BENCH_TIMERS; i++) {
+    switch(i % 4) {
+    case 1:
+      etimer_stop(&timers[i]);
+      states[i] = TIMER_STOPPED;
+      num_pending--;
+      break;
+    case 2:
+      etimer_adjust(&timers[i], -(int)(random_rand() % 20));
+      break;
+    case 3:
+      etimer_reset_with_new_interval(&timers[i], random_interval());
+      break;
+    }
+    check_next_expiration();
+  }
+
+  etimer_set(&deadline, SPAN * 2 + SLACK * 2);
+  while(num_pending > 0) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+    if(data == &deadline) {
+      break;
+    }
+    timer_expired_event(data);
+    check_next_expiration();
+  }
+  etimer_stop(&deadline);
+
+  UNIT_TEST_RUN(expiration);
+  UNIT_TEST_RUN(stop);
+
+  if(!UNIT_TEST_PASSED(expiration) ||
+     !UNIT_TEST_PASSED(stop)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
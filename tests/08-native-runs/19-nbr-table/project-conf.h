@@ -0,0 +1,10 @@
+#ifndef PROJECT_CONF_H
+#define PROJECT_CONF_H
+
+/* A table small enough for the probe sequences of the link-layer address
+   index to collide and wrap around. */
+#ifndef NBR_TABLE_CONF_MAX_NEIGHBORS
+#define NBR_TABLE_CONF_MAX_NEIGHBORS 16
+#endif
+
+#endif /* !PROJECT_CONF_H */
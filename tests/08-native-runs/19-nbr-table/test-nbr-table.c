@@ -0,0 +1,357 @@
+/*
+ * \file
+ *      Tests and benchmark of the neighbor lookups by link-layer address.
+ *
+ *      Adds neighbors whose probe sequences in the link-layer address index
+ *      collide and wrap around its end, removes some of them through the
+ *      garbage collection of the full table, and checks every lookup
+ *      against a walk over the table while neighbors come and go.
+ *      nbr_table_get_from_lladdr() on a full table is timed as well when
+ *      BENCH_CONF_LOOKUPS is given, e.g.
+ *      make DEFINES=NBR_TABLE_CONF_WITH_LLADDR_INDEX=0,BENCH_CONF_LOOKUPS=100000
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "net/nbr-table.h"
+#include "unit-test/unit-test.h"
+/*****************************************************************************/
+/* Number of neighbors added or removed by the churn test. */
+#ifdef BENCH_CONF_CHURN
+#define BENCH_CHURN BENCH_CONF_CHURN
+#else
+#define BENCH_CHURN 20000
+#endif
+
+/* Number of addresses the neighbors are taken from. */
+#define POOL_SIZE (3 * NBR_TABLE_MAX_NEIGHBORS)
+
+/* The first addresses of the pool: four whose home slot is the one before
+   last of the index, one whose home slot is the last one and one whose
+   home slot is the first one. Their probe sequence wraps around. */
+#define NUM_WRAPPED 6
+/*****************************************************************************/
+PROCESS(test_nbr_table_process, "Neighbor table test");
+AUTOSTART_PROCESSES(&test_nbr_table_process);
+
+struct test_item {
+  int pool_index;
+};
+NBR_TABLE(struct test_item, test_table);
+
+static linkaddr_t pool[POOL_SIZE];
+/*****************************************************************************/
+/* The home slot of an address in the index, hashed as nbr-table.c does. */
+static int
+home_slot(const linkaddr_t *lladdr)
+{
+  unsigned hash = 0;
+  int i;
+
+  for(i = 0; i < LINKADDR_SIZE; i++) {
+    hash = hash * 31 + lladdr->u8[i];
+  }
+  return hash % NBR_TABLE_LLADDR_INDEX_SIZE;
+}
+/*****************************************************************************/
+/* Sets the next address, after the counter, whose home slot is home. */
+static void
+make_lladdr(linkaddr_t *lladdr, int home, uint16_t *counter)
+{
+  do {
+    memset(lladdr, 0, sizeof(*lladdr));
+    lladdr->u8[0] = 0x02;
+    lladdr->u8[LINKADDR_SIZE - 2] = *counter >> 8;
+    lladdr->u8[LINKADDR_SIZE - 1] = *counter & 0xff;
+    (*counter)++;
+  } while(home_slot(lladdr) != home);
+}
+/*****************************************************************************/
+static void
+init_pool(void)
+{
+  static const int wrapped_homes[NUM_WRAPPED] = {
+    NBR_TABLE_LLADDR_INDEX_SIZE - 2, NBR_TABLE_LLADDR_INDEX_SIZE - 2,
+    NBR_TABLE_LLADDR_INDEX_SIZE - 2, NBR_TABLE_LLADDR_INDEX_SIZE - 2,
+    NBR_TABLE_LLADDR_INDEX_SIZE - 1, 0
+  };
+  uint16_t counter = 0;
+  int i;
+
+  for(i = 0; i < NUM_WRAPPED; i++) {
+    make_lladdr(&pool[i], wrapped_homes[i], &counter);
+  }
+  /* The others collide now and then, away from the wrapped sequence */
+  for(; i < POOL_SIZE; i++) {
+    make_lladdr(&pool[i], 2 + (i * 7) % (NBR_TABLE_LLADDR_INDEX_SIZE - 4),
+                &counter);
+  }
+}
+/*****************************************************************************/
+static struct test_item *
+add(int i)
+{
+  struct test_item *item;
+
+  item = nbr_table_add_lladdr(test_table, &pool[i],
+                              NBR_TABLE_REASON_UNDEFINED, NULL);
+  if(item != NULL) {
+    item->pool_index = i;
+  }
+  return item;
+}
+/*****************************************************************************/
+static struct test_item *
+lookup(int i)
+{
+  return nbr_table_get_from_lladdr(test_table, &pool[i]);
+}
+/*****************************************************************************/
+/* The item of an address, walking the whole table. */
+static struct test_item *
+walk_lookup(int i)
+{
+  struct test_item *item;
+
+  for(item = nbr_table_head(test_table); item != NULL;
+      item = nbr_table_next(test_table, item)) {
+    if(linkaddr_cmp(nbr_table_get_lladdr(test_table, item), &pool[i])) {
+      return item;
+    }
+  }
+  return NULL;
+}
+/*****************************************************************************/
+/* Counts the addresses of the pool whose lookup disagrees with the walk. */
+static int
+check_lookups(void)
+{
+  struct test_item *item;
+  int mismatches = 0;
+  int i;
+
+  for(i = 0; i < POOL_SIZE; i++) {
+    item = lookup(i);
+    if(item != walk_lookup(i) || (item != NULL && item->pool_index != i)) {
+      mismatches++;
+    }
+  }
+  return mismatches;
+}
+/*****************************************************************************/
+static int
+count_keys(void)
+{
+  nbr_table_key_t *key;
+  int count = 0;
+
+  for(key = nbr_table_key_head(); key != NULL; key = nbr_table_key_next(key)) {
+    count++;
+  }
+  return count;
+}
+/*****************************************************************************/
+/* Removes a neighbor from the table, which then makes room for another
+   one, as the only neighbor no table uses. */
+static int
+replace(int removed, int added)
+{
+  nbr_table_remove(test_table, lookup(removed));
+  if(lookup(removed) != NULL || count_keys() != NBR_TABLE_MAX_NEIGHBORS) {
+    return 0;
+  }
+  return add(added) != NULL && count_keys() == NBR_TABLE_MAX_NEIGHBORS &&
+         lookup(removed) == NULL && walk_lookup(removed) == NULL;
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(wrapped, "Wrapped probe sequences");
+UNIT_TEST(wrapped)
+{
+  int i;
+
+  UNIT_TEST_BEGIN();
+
+  nbr_table_clear();
+  UNIT_TEST_ASSERT(count_keys() == 0);
+
+  for(i = 0; i < NBR_TABLE_MAX_NEIGHBORS; i++) {
+    UNIT_TEST_ASSERT(lookup(i) == NULL);
+    UNIT_TEST_ASSERT(add(i) != NULL);
+    UNIT_TEST_ASSERT(lookup(i) != NULL);
+  }
+  UNIT_TEST_ASSERT(count_keys() == NBR_TABLE_MAX_NEIGHBORS);
+  UNIT_TEST_ASSERT(check_lookups() == 0);
+
+  /* Adding a neighbor again finds its key */
+  UNIT_TEST_ASSERT(add(0) == lookup(0));
+  nbr_table_remove(test_table, lookup(1));
+  UNIT_TEST_ASSERT(lookup(1) == NULL);
+  UNIT_TEST_ASSERT(add(1) != NULL);
+  UNIT_TEST_ASSERT(count_keys() == NBR_TABLE_MAX_NEIGHBORS);
+
+  /* Deleting from the head, middle and tail of the wrapped sequence moves
+     back the neighbors after them, those past the end of the index
+     included */
+  UNIT_TEST_ASSERT(replace(0, NBR_TABLE_MAX_NEIGHBORS));
+  UNIT_TEST_ASSERT(check_lookups() == 0);
+  UNIT_TEST_ASSERT(replace(2, NBR_TABLE_MAX_NEIGHBORS + 1));
+  UNIT_TEST_ASSERT(check_lookups() == 0);
+  UNIT_TEST_ASSERT(replace(5, NBR_TABLE_MAX_NEIGHBORS + 2));
+  UNIT_TEST_ASSERT(check_lookups() == 0);
+  UNIT_TEST_ASSERT(replace(4, 0));
+  UNIT_TEST_ASSERT(check_lookups() == 0);
+  UNIT_TEST_ASSERT(replace(1, 2));
+  UNIT_TEST_ASSERT(check_lookups() == 0);
+
+  /* A full table whose neighbors are all locked takes no new one */
+  for(i = 0; i < POOL_SIZE; i++) {
+    if(lookup(i) != NULL) {
+      nbr_table_lock(test_table, lookup(i));
+    }
+  }
+  UNIT_TEST_ASSERT(lookup(NBR_TABLE_MAX_NEIGHBORS + 3) == NULL);
+  UNIT_TEST_ASSERT(add(NBR_TABLE_MAX_NEIGHBORS + 3) == NULL);
+  UNIT_TEST_ASSERT(lookup(NBR_TABLE_MAX_NEIGHBORS + 3) == NULL);
+  UNIT_TEST_ASSERT(count_keys() == NBR_TABLE_MAX_NEIGHBORS);
+  UNIT_TEST_ASSERT(check_lookups() == 0);
+  for(i = 0; i < POOL_SIZE; i++) {
+    if(lookup(i) != NULL) {
+      nbr_table_unlock(test_table, lookup(i));
+    }
+  }
+
+  /* Unless one of them is not used */
+  UNIT_TEST_ASSERT(replace(3, NBR_TABLE_MAX_NEIGHBORS + 3));
+  UNIT_TEST_ASSERT(check_lookups() == 0);
+
+  nbr_table_clear();
+  UNIT_TEST_ASSERT(count_keys() == 0);
+  UNIT_TEST_ASSERT(check_lookups() == 0);
+  for(i = 0; i < POOL_SIZE; i++) {
+    UNIT_TEST_ASSERT(lookup(i) == NULL);
+  }
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+UNIT_TEST_REGISTER(churn, "Neighbors coming and going");
+UNIT_TEST(churn)
+{
+  unsigned added = 0;
+  unsigned removed = 0;
+  unsigned failed = 0;
+  unsigned mismatches = 0;
+  int i, n;
+
+  UNIT_TEST_BEGIN();
+
+  nbr_table_clear();
+  random_init(1);
+
+  /* Once the table is full, each new neighbor takes the key of an unused
+     one or, failing that, of the first one */
+  for(n = 0; n < BENCH_CHURN; n++) {
+    i = random_rand() % POOL_SIZE;
+    if(lookup(i) == NULL) {
+      if(add(i) != NULL) {
+        added++;
+      } else {
+        failed++;
+      }
+    } else if(random_rand() % 2) {
+      nbr_table_remove(test_table, lookup(i));
+      removed++;
+    }
+    mismatches += check_lookups();
+  }
+
+  printf("churn: %u added, %u removed, %d keys\n", added, removed,
+         count_keys());
+
+  UNIT_TEST_ASSERT(failed == 0);
+  UNIT_TEST_ASSERT(mismatches == 0);
+  UNIT_TEST_ASSERT(removed > 0);
+  UNIT_TEST_ASSERT(count_keys() == NBR_TABLE_MAX_NEIGHBORS);
+
+  nbr_table_clear();
+  UNIT_TEST_ASSERT(check_lookups() == 0);
+
+  UNIT_TEST_END();
+}
+/*****************************************************************************/
+#ifdef BENCH_CONF_LOOKUPS
+/* Number of lookups timed. */
+#define BENCH_LOOKUPS BENCH_CONF_LOOKUPS
+
+static uint64_t
+now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+/*****************************************************************************/
+/* Lookups of the neighbors of a full table, timed for comparing the index
+   with the linear search on a given host rather than checked. */
+static void
+benchmark(void)
+{
+  uint64_t start;
+  double lookup_ns;
+  unsigned found = 0;
+  int i;
+
+  nbr_table_clear();
+  for(i = 0; i < NBR_TABLE_MAX_NEIGHBORS; i++) {
+    add(NUM_WRAPPED + i);
+  }
+
+  start = now_ns();
+  for(i = 0; i < BENCH_LOOKUPS; i++) {
+    found += lookup(NUM_WRAPPED + i % NBR_TABLE_MAX_NEIGHBORS) != NULL;
+  }
+  lookup_ns = (double)(now_ns() - start) / BENCH_LOOKUPS;
+
+  printf("nbr_table_get_from_lladdr: %d neighbors, index %d, %.1f ns/op, "
+         "%u of %u found\n", NBR_TABLE_MAX_NEIGHBORS,
+         NBR_TABLE_WITH_LLADDR_INDEX, lookup_ns, found, BENCH_LOOKUPS);
+
+  nbr_table_clear();
+}
+#endif /* BENCH_CONF_LOOKUPS */
+/*****************************************************************************/
+PROCESS_THREAD(test_nbr_table_process, ev, data)
+{
+  PROCESS_BEGIN();
+
+  printf("Run unit-test\n");
+  printf("---\n");
+
+  nbr_table_register(test_table, NULL);
+  init_pool();
+
+  UNIT_TEST_RUN(wrapped);
+  UNIT_TEST_RUN(churn);
+#ifdef BENCH_CONF_LOOKUPS
+  benchmark();
+#endif
+
+  if(!UNIT_TEST_PASSED(wrapped) ||
+     !UNIT_TEST_PASSED(churn)) {
+    printf("=check-me= FAILED\n");
+    printf("---\n");
+  }
+
+  printf("=check-me= DONE\n");
+  printf("---\n");
+
+  PROCESS_END();
+}
+/*****************************************************************************/